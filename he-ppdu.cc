@@ -282,11 +282,25 @@ HePpdu::SetHeMuUserInfos(WifiTxVector& txVector,
             auto primary80 = ruAllocIndex < 4;
             auto num20MhzSubchannelsInRu = (ruBw < 20) ? 1 : (ruBw / 20);
             auto numRuAllocsInContentChannel = std::max(1, num20MhzSubchannelsInRu / 2);
-            auto ruIndexOffset = (ruBw < 20) ? (ruSpecs.size() * ruAllocIndex)
-                                             : (ruAllocIndex / num20MhzSubchannelsInRu);
-            if (!primary80)
+            std::size_t ruIndexOffset = 0;
+            if (ruBw < 20)
             {
-                ruIndexOffset -= HeRu::GetRusOfType(80, ruType, 0, false).size();
+                // RU_ALLOCATION may signal RUs of different types, hence the offset is
+                // given by the number of RUs of this type in the preceding subchannels of
+                // the same 80 MHz, plus the center 26-tone RU if located in between
+                ruIndexOffset = HeRu::GetNRus(20, ruType) * (ruAllocIndex % 4);
+                if (ruType == HeRu::RU_26_TONE && (ruAllocIndex % 4) >= 2)
+                {
+                    ruIndexOffset++;
+                }
+            }
+            else
+            {
+                ruIndexOffset = ruAllocIndex / num20MhzSubchannelsInRu;
+                if (!primary80)
+                {
+                    ruIndexOffset -= HeRu::GetNRus(80, ruType);
+                }
             }
             if (!txVector.IsAllocated(userInfo.staId))
             {
@@ -581,9 +595,7 @@ HePpdu::GetHeSigBContentChannels(const WifiTxVector& txVector, uint8_t p20Index)
             continue;
         }
 
-        std::size_t numRus = (ruType >= HeRu::RU_242_TONE)
-                                 ? 1
-                                 : HeRu::m_heRuSubcarrierGroups.at({20, ruType}).size();
+        std::size_t numRus = (ruType >= HeRu::RU_242_TONE) ? 1 : HeRu::GetNRus(20, ruType);
         const auto ruIdx = ru.GetIndex();
         for (auto staId : staIds)
         {
@@ -487,104 +487,203 @@ HeRu::RuSpec::GetPhyIndex(uint16_t bw, uint8_t p20Index) const
     }
 }
 
-std::size_t
-HeRu::GetNRus(uint16_t bw, RuType ruType)
+namespace
 {
-    if (bw == 160 && ruType == RU_2x996_TONE)
-    {
-        return 1;
-    }
 
-    // if the bandwidth is 160MHz, search for the number of RUs available
-    // in 80MHz and double the result.
-    auto it = m_heRuSubcarrierGroups.find({(bw == 160 ? 80 : bw), ruType});
+/// Number of channel widths covered by the RU tables (20, 40, 80 and 160 MHz)
+constexpr std::size_t N_BWS = 4;
+/// Number of RU types
+constexpr std::size_t N_RU_TYPES = HeRu::RU_2x996_TONE + 1;
 
-    if (it == m_heRuSubcarrierGroups.end())
+/**
+ * RUs available in a HE PPDU, indexed by channel width and RU type
+ */
+struct RuTables
+{
+    std::vector<HeRu::RuSpec> rus[N_BWS][N_RU_TYPES];       //!< all the RUs of a given type
+    std::vector<HeRu::RuSpec> central26[N_BWS][N_RU_TYPES]; /**< 26-tone RUs that can be
+                                                                 additionally allocated when the
+                                                                 channel is split in RUs of a
+                                                                 given type */
+    HeRu::RuMask masks[N_BWS][N_RU_TYPES][HeRu::N_26_TONE_RUS_PER_80MHZ]; /**< masks of the RUs
+                                                                         of a given type in
+                                                                         the primary 80 MHz */
+    uint8_t overlapping[N_BWS][N_RU_TYPES][HeRu::N_26_TONE_RUS_PER_80MHZ]; /**< index of the RU
+                                                                          of a given type that
+                                                                          includes a 26-tone
+                                                                          RU (0 if none) */
+};
+
+/**
+ * \param bw the bandwidth (MHz) of the HE PPDU
+ * \return the index of the given bandwidth in the RU tables (N_BWS if not supported)
+ */
+std::size_t
+GetBwIndex(uint16_t bw)
+{
+    switch (bw)
     {
+    case 20:
         return 0;
+    case 40:
+        return 1;
+    case 80:
+        return 2;
+    case 160:
+        return 3;
+    default:
+        return N_BWS;
     }
-
-    return (bw == 160 ? 2 : 1) * it->second.size();
 }
 
-std::vector<HeRu::RuSpec>
-HeRu::GetRusOfType(uint16_t bw, HeRu::RuType ruType, std::size_t ru_index, bool prop)
+/**
+ * Build the RU tables from the subcarrier groups. RUs in a 160 MHz channel are
+ * those of the primary 80 MHz followed by those of the secondary 80 MHz.
+ *
+ * \return the RU tables
+ */
+RuTables
+BuildRuTables()
 {
-    if (ruType == HeRu::RU_2x996_TONE)
-    {
-        NS_ASSERT(bw >= 160);
-        return {{ruType, 1, true}};
-    }
+    RuTables tables{};
+    const uint16_t bws[N_BWS] = {20, 40, 80, 160};
 
-    std::vector<HeRu::RuSpec> ret;
-    std::vector<bool> primary80MHzSet{true};
-
-    if (bw == 160)
+    for (std::size_t b = 0; b < N_BWS; b++)
     {
-        primary80MHzSet.push_back(false);
-        bw = 80;
-    }
+        const uint16_t bw = bws[b];
+        std::vector<bool> primary80MHzSet{true};
+        if (bw == 160)
+        {
+            primary80MHzSet.push_back(false);
+        }
 
-    for (auto primary80MHz : primary80MHzSet)
-    {
-        for (std::size_t ruIndex = 1;
-             ruIndex <= HeRu::m_heRuSubcarrierGroups.at({bw, ruType}).size();
-             ruIndex++)
+        for (std::size_t t = 0; t < N_RU_TYPES; t++)
         {
-            if(prop) {
-              ret.emplace_back(ruType, ru_index, primary80MHz);
-            }else{
-              ret.emplace_back(ruType, ruIndex, primary80MHz);
+            const auto ruType = static_cast<HeRu::RuType>(t);
+
+            if (ruType == HeRu::RU_2x996_TONE)
+            {
+                if (bw == 160)
+                {
+                    tables.rus[b][t].emplace_back(ruType, 1, true);
+                }
+                continue;
+            }
+
+            auto it = HeRu::m_heRuSubcarrierGroups.find({(bw == 160 ? 80 : bw), ruType});
+            if (it != HeRu::m_heRuSubcarrierGroups.end())
+            {
+                for (auto primary80MHz : primary80MHzSet)
+                {
+                    for (std::size_t ruIndex = 1; ruIndex <= it->second.size(); ruIndex++)
+                    {
+                        tables.rus[b][t].emplace_back(ruType, ruIndex, primary80MHz);
+                    }
+                }
+
+                // a 26-tone RU is marked as occupied by an RU if they share a tone
+                const auto& units =
+                    HeRu::m_heRuSubcarrierGroups.at({(bw == 160 ? 80 : bw), HeRu::RU_26_TONE});
+                for (std::size_t ruIndex = 1; ruIndex <= it->second.size(); ruIndex++)
+                {
+                    for (std::size_t unit = 0; unit < units.size(); unit++)
+                    {
+                        for (const auto& rangeRu : it->second.at(ruIndex - 1))
+                        {
+                            for (const auto& rangeUnit : units.at(unit))
+                            {
+                                if (rangeUnit.second >= rangeRu.first &&
+                                    rangeRu.second >= rangeUnit.first)
+                                {
+                                    tables.masks[b][t][ruIndex - 1].bits[0] |= (1ULL << unit);
+                                    if (tables.overlapping[b][t][unit] == 0)
+                                    {
+                                        tables.overlapping[b][t][unit] = ruIndex;
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            std::vector<std::size_t> indices;
+            if (ruType == HeRu::RU_52_TONE || ruType == HeRu::RU_106_TONE)
+            {
+                if (bw == 20)
+                {
+                    indices.push_back(5);
+                }
+                else if (bw == 40)
+                {
+                    indices.insert(indices.end(), {5, 14});
+                }
+                else
+                {
+                    indices.insert(indices.end(), {5, 14, 19, 24, 33});
+                }
+            }
+            else if (ruType == HeRu::RU_242_TONE || ruType == HeRu::RU_484_TONE)
+            {
+                if (bw >= 80)
+                {
+                    indices.push_back(19);
+                }
+            }
+
+            for (auto primary80MHz : primary80MHzSet)
+            {
+                for (const auto& index : indices)
+                {
+                    tables.central26[b][t].emplace_back(HeRu::RU_26_TONE, index, primary80MHz);
+                }
             }
         }
     }
-    return ret;
+    return tables;
 }
 
-std::vector<HeRu::RuSpec>
-HeRu::GetCentral26TonesRus(uint16_t bw, HeRu::RuType ruType)
+/**
+ * \return the RU tables, which are built upon the first call
+ */
+const RuTables&
+GetRuTables()
 {
-    std::vector<std::size_t> indices;
+    static const RuTables tables = BuildRuTables();
+    return tables;
+}
 
-    if (ruType == HeRu::RU_52_TONE || ruType == HeRu::RU_106_TONE)
-    {
-        if (bw == 20)
-        {
-            indices.push_back(5);
-        }
-        else if (bw == 40)
-        {
-            indices.insert(indices.end(), {5, 14});
-        }
-        else if (bw >= 80)
-        {
-            indices.insert(indices.end(), {5, 14, 19, 24, 33});
-        }
-    }
-    else if (ruType == HeRu::RU_242_TONE || ruType == HeRu::RU_484_TONE)
-    {
-        if (bw >= 80)
-        {
-            indices.push_back(19);
-        }
-    }
+} // namespace
 
-    std::vector<HeRu::RuSpec> ret;
-    std::vector<bool> primary80MHzSet{true};
+std::size_t
+HeRu::GetNRus(uint16_t bw, RuType ruType)
+{
+    const auto b = GetBwIndex(bw);
+    return (b < N_BWS) ? GetRuTables().rus[b][ruType].size() : 0;
+}
 
-    if (bw == 160)
-    {
-        primary80MHzSet.push_back(false);
-    }
+HeRu::RuSpecSpan
+HeRu::GetRusOfType(uint16_t bw, HeRu::RuType ruType)
+{
+    NS_ASSERT(ruType != HeRu::RU_2x996_TONE || bw >= 160);
+    const auto b = GetBwIndex(bw);
+    NS_ABORT_MSG_IF(b == N_BWS, "Unsupported bandwidth: " << bw << " MHz");
+
+    const auto& rus = GetRuTables().rus[b][ruType];
+    return {rus.data(), rus.size()};
+}
 
-    for (auto primary80MHz : primary80MHzSet)
+HeRu::RuSpecSpan
+HeRu::GetCentral26TonesRus(uint16_t bw, HeRu::RuType ruType)
+{
+    const auto b = GetBwIndex(bw);
+    if (b == N_BWS)
     {
-        for (const auto& index : indices)
-        {
-            ret.emplace_back(HeRu::RU_26_TONE, index, primary80MHz);
-        }
+        return {};
     }
-    return ret;
+
+    const auto& rus = GetRuTables().central26[b][ruType];
+    return {rus.data(), rus.size()};
 }
 
 HeRu::SubcarrierGroup
@@ -626,6 +725,38 @@ HeRu::GetSubcarrierGroup(uint16_t bw, RuType ruType, std::size_t phyIndex)
     return group;
 }
 
+HeRu::RuMask
+HeRu::GetRuMask(uint16_t bw, RuSpec ru)
+{
+    RuMask mask;
+    const auto ruType = ru.GetRuType();
+
+    if (ruType == HeRu::RU_2x996_TONE) // handle special case of RU covering 160 MHz channel
+    {
+        NS_ABORT_MSG_IF(bw != 160, "2x996 tone RU can only be used on 160 MHz band");
+        mask.bits[0] = ~0ULL;
+        mask.bits[1] = (1ULL << (2 * N_26_TONE_RUS_PER_80MHZ - 64)) - 1;
+        return mask;
+    }
+
+    // masks of RUs in a 160 MHz channel are those of the RUs in the 80 MHz channel
+    const auto b = GetBwIndex(bw == 160 ? 80 : bw);
+    NS_ABORT_MSG_IF(b == N_BWS, "Unsupported bandwidth: " << bw << " MHz");
+    const auto index = ru.GetIndex();
+    NS_ABORT_MSG_IF(index == 0 || index > GetNRus(bw, ruType) / (bw == 160 ? 2 : 1),
+                    "RU index not available");
+
+    const auto& mask80 = GetRuTables().masks[b][ruType][index - 1];
+    if (ru.GetPrimary80MHz())
+    {
+        return mask80;
+    }
+    // shift the mask to the bits of the secondary 80 MHz channel
+    mask.bits[0] = mask80.bits[0] << N_26_TONE_RUS_PER_80MHZ;
+    mask.bits[1] = mask80.bits[0] >> (64 - N_26_TONE_RUS_PER_80MHZ);
+    return mask;
+}
+
 bool
 HeRu::DoesOverlap(uint16_t bw, RuSpec ru, const std::vector<RuSpec>& v)
 {
@@ -636,27 +767,14 @@ HeRu::DoesOverlap(uint16_t bw, RuSpec ru, const std::vector<RuSpec>& v)
     }
 
     // This function may be called by the MAC layer, hence the PHY index may have
-    // not been set yet. Hence, we pass the "MAC" index to GetSubcarrierGroup instead
-    // of the PHY index. This is fine because we compare the primary 80 MHz bands of
-    // the two RUs below.
-    SubcarrierGroup rangesRu = GetSubcarrierGroup(bw, ru.GetRuType(), ru.GetIndex());
+    // not been set yet. Hence, masks are looked up by the "MAC" index, which is
+    // fine because masks also encode the 80 MHz band the RU is located in.
+    const auto maskRu = GetRuMask(bw, ru);
     for (auto& p : v)
     {
-        if (ru.GetPrimary80MHz() != p.GetPrimary80MHz())
+        if (maskRu.Overlaps(GetRuMask(bw, p)))
         {
-            // the two RUs are located in distinct 80MHz bands
-            continue;
-        }
-        for (const auto& rangeRu : rangesRu)
-        {
-            SubcarrierGroup rangesP = GetSubcarrierGroup(bw, p.GetRuType(), p.GetIndex());
-            for (auto& rangeP : rangesP)
-            {
-                if (rangeP.second >= rangeRu.first && rangeRu.second >= rangeP.first)
-                {
-                    return true;
-                }
-            }
+            return true;
         }
     }
     return false;
@@ -665,15 +783,21 @@ HeRu::DoesOverlap(uint16_t bw, RuSpec ru, const std::vector<RuSpec>& v)
 bool
 HeRu::DoesOverlap(uint16_t bw, RuSpec ru, const SubcarrierGroup& toneRanges, uint8_t p20Index)
 {
-    for (const auto& range : toneRanges)
+    if (toneRanges.empty())
     {
-        if (bw == 160 && ru.GetRuType() == RU_2x996_TONE)
-        {
-            return true;
-        }
+        return false;
+    }
+
+    if (bw == 160 && ru.GetRuType() == RU_2x996_TONE)
+    {
+        return true;
+    }
 
-        SubcarrierGroup rangesRu =
-            GetSubcarrierGroup(bw, ru.GetRuType(), ru.GetPhyIndex(bw, p20Index));
+    // the tone ranges are not aligned to 26-tone RUs, hence compare subcarriers
+    SubcarrierGroup rangesRu =
+        GetSubcarrierGroup(bw, ru.GetRuType(), ru.GetPhyIndex(bw, p20Index));
+    for (const auto& range : toneRanges)
+    {
         for (auto& r : rangesRu)
         {
             if (range.second >= r.first && r.second >= range.first)
@@ -688,33 +812,30 @@ HeRu::DoesOverlap(uint16_t bw, RuSpec ru, const SubcarrierGroup& toneRanges, uin
 HeRu::RuSpec
 HeRu::FindOverlappingRu(uint16_t bw, RuSpec referenceRu, RuType searchedRuType)
 {
-    std::size_t numRus = HeRu::GetNRus(bw, searchedRuType);
-
-    std::size_t numRusPer80Mhz;
-    std::vector<bool> primary80MhzFlags;
-    if (bw == 160)
+    if (searchedRuType == HeRu::RU_2x996_TONE)
     {
-        primary80MhzFlags.push_back(true);
-        primary80MhzFlags.push_back(false);
-        numRusPer80Mhz = (searchedRuType == HeRu::RU_2x996_TONE ? 1 : numRus / 2);
-    }
-    else
-    {
-        primary80MhzFlags.push_back(referenceRu.GetPrimary80MHz());
-        numRusPer80Mhz = numRus;
+        NS_ABORT_MSG_IF(bw != 160, "2x996 tone RU can only be used on 160 MHz band");
+        return {searchedRuType, 1, true};
     }
 
-    for (const auto primary80MHz : primary80MhzFlags)
+    const auto b = GetBwIndex(bw == 160 ? 80 : bw);
+    NS_ABORT_MSG_IF(b == N_BWS, "Unsupported bandwidth: " << bw << " MHz");
+    const auto& overlapping = GetRuTables().overlapping[b][searchedRuType];
+
+    // RUs of the same type are numbered in increasing frequency order, hence the
+    // searched RU is the one including the lowest 26-tone RU of the reference RU
+    // that is included in an RU of the searched type
+    const auto mask = GetRuMask(bw, referenceRu);
+    for (std::size_t bit = 0; bit < 2 * N_26_TONE_RUS_PER_80MHZ; bit++)
     {
-        std::size_t index = 1;
-        for (std::size_t indexPer80Mhz = 1; indexPer80Mhz <= numRusPer80Mhz;
-             ++indexPer80Mhz, ++index)
+        if (((mask.bits[bit / 64] >> (bit % 64)) & 1) == 0)
         {
-            RuSpec searchedRu(searchedRuType, index, primary80MHz);
-            if (DoesOverlap(bw, referenceRu, {searchedRu}))
-            {
-                return searchedRu;
-            }
+            continue;
+        }
+        const auto index = overlapping[bit % N_26_TONE_RUS_PER_80MHZ];
+        if (index != 0)
+        {
+            return {searchedRuType, index, (bit < N_26_TONE_RUS_PER_80MHZ)};
         }
     }
     NS_ABORT_MSG("The searched RU type " << searchedRuType << " was not found for bw=" << bw
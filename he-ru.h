@@ -162,6 +162,104 @@ class HeRu
         uint8_t m_p20Index;      ///< Primary20 channel index
     };
 
+    /**
+     * Read-only view over a contiguous sequence of RUs. The RUs are stored in
+     * tables that are computed once (for all the channel widths and RU types) and
+     * never modified afterwards, hence a view is cheap to copy and never dangles.
+     */
+    class RuSpecSpan
+    {
+      public:
+        /// iterator over the RUs of the view
+        typedef const RuSpec* const_iterator;
+
+        /**
+         * Constructor
+         *
+         * \param data pointer to the first RU of the view
+         * \param size the number of RUs in the view
+         */
+        RuSpecSpan(const RuSpec* data = nullptr, std::size_t size = 0)
+            : m_data(data),
+              m_size(size)
+        {
+        }
+
+        /// \return an iterator to the first RU of the view
+        const_iterator begin() const
+        {
+            return m_data;
+        }
+
+        /// \return an iterator past the last RU of the view
+        const_iterator end() const
+        {
+            return m_data + m_size;
+        }
+
+        /// \return the number of RUs in the view
+        std::size_t size() const
+        {
+            return m_size;
+        }
+
+        /// \return whether the view is empty
+        bool empty() const
+        {
+            return m_size == 0;
+        }
+
+        /**
+         * \param i the position (starting at 0) of an RU in the view
+         * \return the RU at the given position
+         */
+        const RuSpec& operator[](std::size_t i) const
+        {
+            return m_data[i];
+        }
+
+      private:
+        const RuSpec* m_data; //!< first RU of the view
+        std::size_t m_size;   //!< number of RUs in the view
+    };
+
+    /// Number of 26-tone RUs in an 80 MHz channel
+    static constexpr std::size_t N_26_TONE_RUS_PER_80MHZ = 37;
+
+    /**
+     * Occupancy of one or more RUs at the granularity of 26-tone RUs. Bit i
+     * (i < N_26_TONE_RUS_PER_80MHZ) is set if the (i+1)-th 26-tone RU of the primary
+     * 80 MHz channel is occupied, while bit N_26_TONE_RUS_PER_80MHZ + i refers to the
+     * (i+1)-th 26-tone RU of the secondary 80 MHz channel. Given that HE RUs are
+     * nested, two RUs overlap if and only if their masks have a bit in common.
+     */
+    struct RuMask
+    {
+        uint64_t bits[2]{0, 0}; //!< the (at most 74) bits of the mask, lowest bits first
+
+        /**
+         * \param other another mask
+         * \return whether this mask and the given mask have a bit in common
+         */
+        bool Overlaps(const RuMask& other) const
+        {
+            return ((bits[0] & other.bits[0]) | (bits[1] & other.bits[1])) != 0;
+        }
+
+        /**
+         * Add the bits of the given mask to this mask.
+         *
+         * \param other the given mask
+         * \return a reference to this mask
+         */
+        RuMask& operator|=(const RuMask& other)
+        {
+            bits[0] |= other.bits[0];
+            bits[1] |= other.bits[1];
+            return *this;
+        }
+    };
+
     /**
      * Get the number of distinct RUs of the given type (number of tones)
      * available in a HE PPDU of the given bandwidth.
@@ -178,9 +276,10 @@ class HeRu
      *
      * \param bw the bandwidth (MHz) of the HE PPDU (20, 40, 80, 160)
      * \param ruType the RU type (number of tones)
-     * \return the set of distinct RUs available
+     * \return the set of distinct RUs available (empty if the given bandwidth
+     *         cannot be split in RUs of the given type)
      */
-    static std::vector<HeRu::RuSpec> GetRusOfType(uint16_t bw, HeRu::RuType ruType, std::size_t ru_index, bool prop);
+    static RuSpecSpan GetRusOfType(uint16_t bw, HeRu::RuType ruType);
 
     /**
      * Get the set of 26-tone RUs that can be additionally allocated if the given
@@ -190,7 +289,7 @@ class HeRu
      * \param ruType the RU type (number of tones)
      * \return the set of 26-tone RUs that can be additionally allocated
      */
-    static std::vector<HeRu::RuSpec> GetCentral26TonesRus(uint16_t bw, HeRu::RuType ruType);
+    static RuSpecSpan GetCentral26TonesRus(uint16_t bw, HeRu::RuType ruType);
 
     /**
      * Get the subcarrier group of the RU having the given PHY index among all the
@@ -208,6 +307,17 @@ class HeRu
      */
     static SubcarrierGroup GetSubcarrierGroup(uint16_t bw, RuType ruType, std::size_t phyIndex);
 
+    /**
+     * Get the 26-tone occupancy mask of the given RU. The masks of all the RUs are
+     * precomputed, hence this function performs a table lookup. As in DoesOverlap,
+     * the index of the given RU is the index within its 80 MHz channel.
+     *
+     * \param bw the bandwidth (MHz) of the HE PPDU (20, 40, 80, 160)
+     * \param ru the given RU
+     * \return the 26-tone occupancy mask of the given RU
+     */
+    static RuMask GetRuMask(uint16_t bw, RuSpec ru);
+
     /**
      * Check whether the given RU overlaps with the given set of RUs.
      * Note that for channel width of 160 MHz the returned range is relative to
@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2020 Universita' degli Studi di Napoli Federico II
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/boolean.h"
+#include "ns3/he-phy.h"
+#include "ns3/he-ppdu.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/multi-model-spectrum-channel.h"
+#include "ns3/packet.h"
+#include "ns3/propagation-delay-model.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/rr-multi-user-scheduler.h"
+#include "ns3/simulator.h"
+#include "ns3/spectrum-wifi-helper.h"
+#include "ns3/ssid.h"
+#include "ns3/string.h"
+#include "ns3/test.h"
+#include "ns3/uinteger.h"
+#include "ns3/vht-phy.h"
+#include "ns3/wifi-mac-header.h"
+#include "ns3/wifi-mac-helper.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-phy-operating-channel.h"
+#include "ns3/wifi-psdu.h"
+
+#include <set>
+
+using namespace ns3;
+
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief Check that the RUs of (possibly) different sizes packed by the RR MU scheduler
+ * are recovered by the receivers of a DL MU PPDU, i.e., that the RUs survive the round
+ * trip through the RU_ALLOCATION subfields and the user fields of HE-SIG-B.
+ */
+class RrMuSchedulerRuPackingTest : public TestCase
+{
+  public:
+    RrMuSchedulerRuPackingTest();
+
+  private:
+    void DoRun() override;
+
+    /**
+     * Pack RUs for random tone demands of a random number of stations and check that
+     * the RUs decoded from HE-SIG-B match the packed RUs.
+     *
+     * \param bw the channel width (MHz)
+     * \param nRuns the number of random packings to check
+     */
+    void RunPackings(uint16_t bw, std::size_t nRuns);
+
+    Ptr<UniformRandomVariable> m_rv; //!< random variable for the tone demands
+};
+
+RrMuSchedulerRuPackingTest::RrMuSchedulerRuPackingTest()
+    : TestCase("Check the HE-SIG-B round trip of RUs packed by the RR MU scheduler")
+{
+}
+
+void
+RrMuSchedulerRuPackingTest::RunPackings(uint16_t bw, std::size_t nRuns)
+{
+    WifiPhyOperatingChannel channel;
+    channel.SetDefault(bw, WIFI_STANDARD_80211ax, WIFI_PHY_BAND_5GHZ);
+    const auto nUnits = HeRu::GetNRus(bw, HeRu::RU_26_TONE);
+    std::size_t nMixed = 0;
+
+    for (std::size_t run = 0; run < nRuns; run++)
+    {
+        // a few stations with large queues and many stations with small queues
+        const std::size_t nStations =
+            m_rv->GetInteger(1, (run % 2 == 0) ? 12 : RrMultiUserScheduler::MAX_RUS);
+        std::vector<double> weights(nStations);
+        double sum = 0;
+        for (auto& weight : weights)
+        {
+            weight = m_rv->GetValue() * (m_rv->GetValue() < 0.25 ? 10 : 1);
+            sum += weight;
+        }
+        RrMultiUserScheduler::ToneDemand demand;
+        for (std::size_t i = 0; i < nStations; i++)
+        {
+            demand[i] = static_cast<uint8_t>(weights[i] / sum * nUnits);
+        }
+
+        RrMultiUserScheduler::PropAllocation allocation;
+        auto nServed = RrMultiUserScheduler::PackRus(demand, nStations, bw, allocation);
+        if (nServed == 0)
+        {
+            continue;
+        }
+
+        WifiTxVector txVector(HePhy::GetHeMcs7(),
+                              0,
+                              WIFI_PREAMBLE_HE_MU,
+                              800,
+                              1,
+                              1,
+                              0,
+                              bw,
+                              false,
+                              false);
+        txVector.SetSigBMode(VhtPhy::GetVhtMcs5());
+        WifiConstPsduMap psdus;
+        std::set<HeRu::RuType> ruTypes;
+        for (std::size_t i = 0; i < nStations; i++)
+        {
+            if (!allocation[i])
+            {
+                continue;
+            }
+            const uint16_t staId = i + 1;
+            txVector.SetHeMuUserInfo(staId, {*allocation[i], 7, 1});
+            ruTypes.insert(allocation[i]->GetRuType());
+
+            WifiMacHeader hdr;
+            hdr.SetType(WIFI_MAC_QOSDATA);
+            hdr.SetQosTid(0);
+            psdus.emplace(staId, Create<WifiPsdu>(Create<Packet>(100), hdr));
+        }
+        nMixed += (ruTypes.size() > 1 ? 1 : 0);
+
+        // the RU_ALLOCATION subfields are derived by the TXVECTOR
+        auto ppdu = Create<HePpdu>(psdus,
+                                   txVector,
+                                   channel,
+                                   MicroSeconds(100),
+                                   run,
+                                   HePpdu::PSD_NON_HE_PORTION);
+        const auto rxVector = ppdu->GetTxVector();
+
+        NS_TEST_EXPECT_MSG_EQ(rxVector.GetHeMuUserInfoMap().size(),
+                              nServed,
+                              "Unexpected number of user fields decoded at " << bw << " MHz");
+        for (const auto& [staId, userInfo] : txVector.GetHeMuUserInfoMap())
+        {
+            NS_TEST_ASSERT_MSG_EQ(rxVector.IsAllocated(staId),
+                                  true,
+                                  "No RU decoded for station " << staId << " at " << bw
+                                                               << " MHz");
+            NS_TEST_EXPECT_MSG_EQ(rxVector.GetRu(staId),
+                                  userInfo.ru,
+                                  "Wrong RU decoded for station " << staId << " at " << bw
+                                                                  << " MHz");
+        }
+    }
+
+    if (bw >= 40)
+    {
+        NS_TEST_EXPECT_MSG_GT(nMixed, 0, "No packing with RUs of different sizes at " << bw);
+    }
+}
+
+void
+RrMuSchedulerRuPackingTest::DoRun()
+{
+    RngSeedManager::SetSeed(1);
+    RngSeedManager::SetRun(1);
+    m_rv = CreateObject<UniformRandomVariable>();
+    m_rv->SetStream(1);
+
+    for (uint16_t bw : {20, 40, 80, 160})
+    {
+        RunPackings(bw, 2000);
+    }
+}
+
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief Check that the DL MU PPDUs of a DL lookahead plan are sent to consecutive groups
+ * of ranked stations when the NStations attribute exceeds the number of RUs in the channel.
+ * An AP operating on a 20 MHz channel (hence 9 RUs) plans two DL MU PPDUs for 15 stations.
+ * The 9 stations with the largest queues are served by the first DL MU PPDU and the other
+ * 6 stations by the second one, even though the former ones still have the largest queues.
+ */
+class RrMuSchedulerDlPlanTest : public TestCase
+{
+  public:
+    RrMuSchedulerDlPlanTest();
+
+  private:
+    void DoRun() override;
+
+    /**
+     * Callback invoked when the PHY of the AP starts transmitting a PSDU map.
+     *
+     * \param psduMap the PSDU map
+     * \param txVector the TXVECTOR used to transmit the PSDU map
+     * \param txPowerW the TX power in Watts
+     */
+    void Transmit(WifiConstPsduMap psduMap, WifiTxVector txVector, double txPowerW);
+
+    /**
+     * Have the AP enqueue the given number of packets addressed to the given station.
+     *
+     * \param staIndex the index of the station
+     * \param nPackets the number of packets
+     */
+    void Enqueue(std::size_t staIndex, std::size_t nPackets);
+
+    static constexpr std::size_t N_STATIONS = 15;   ///< number of stations
+    static constexpr std::size_t N_SMALL_QUEUES = 6; ///< number of stations with small queues
+
+    Ptr<WifiNetDevice> m_apDevice;  ///< AP device
+    NetDeviceContainer m_staDevices; ///< station devices
+    Time m_trafficStart;             ///< time the queues of the AP are filled
+    std::vector<std::set<std::size_t>>
+        m_dlMuReceivers; ///< indices of the receivers of every DL MU PPDU since traffic start
+};
+
+RrMuSchedulerDlPlanTest::RrMuSchedulerDlPlanTest()
+    : TestCase("Check the DL lookahead plans of the RR MU scheduler when NStations exceeds "
+               "the number of RUs")
+{
+}
+
+void
+RrMuSchedulerDlPlanTest::Transmit(WifiConstPsduMap psduMap, WifiTxVector txVector, double txPowerW)
+{
+    if (Simulator::Now() < m_trafficStart || !txVector.IsDlMu())
+    {
+        return;
+    }
+
+    std::set<std::size_t> receivers;
+    for (const auto& [staId, psdu] : psduMap)
+    {
+        for (std::size_t i = 0; i < N_STATIONS; i++)
+        {
+            if (psdu->GetAddr1() == Mac48Address::ConvertFrom(m_staDevices.Get(i)->GetAddress()))
+            {
+                receivers.insert(i);
+            }
+        }
+    }
+    m_dlMuReceivers.push_back(receivers);
+}
+
+void
+RrMuSchedulerDlPlanTest::Enqueue(std::size_t staIndex, std::size_t nPackets)
+{
+    for (std::size_t i = 0; i < nPackets; i++)
+    {
+        m_apDevice->Send(Create<Packet>(1000), m_staDevices.Get(staIndex)->GetAddress(), 1);
+    }
+}
+
+void
+RrMuSchedulerDlPlanTest::DoRun()
+{
+    RngSeedManager::SetSeed(1);
+    RngSeedManager::SetRun(1);
+    int64_t streamNumber = 100;
+
+    NodeContainer wifiApNode;
+    wifiApNode.Create(1);
+    NodeContainer wifiStaNodes;
+    wifiStaNodes.Create(N_STATIONS);
+
+    auto spectrumChannel = CreateObject<MultiModelSpectrumChannel>();
+    spectrumChannel->AddPropagationLossModel(CreateObject<FriisPropagationLossModel>());
+    spectrumChannel->SetPropagationDelayModel(
+        CreateObject<ConstantSpeedPropagationDelayModel>());
+
+    SpectrumWifiPhyHelper phy;
+    phy.SetChannel(spectrumChannel);
+    phy.Set("ChannelSettings", StringValue("{36, 20, BAND_5GHZ, 0}"));
+
+    WifiHelper wifi;
+    wifi.SetStandard(WIFI_STANDARD_80211ax);
+    wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
+                                 "DataMode",
+                                 StringValue("HeMcs7"),
+                                 "ControlMode",
+                                 StringValue("OfdmRate6Mbps"));
+
+    WifiMacHelper mac;
+    mac.SetType("ns3::StaWifiMac", "Ssid", SsidValue(Ssid("rr-mu-scheduler")));
+    m_staDevices = wifi.Install(phy, mac, wifiStaNodes);
+
+    // NStations is set to the number of stations, as the stats_print example does, and
+    // exceeds the number of RUs in a 20 MHz channel
+    mac.SetType("ns3::ApWifiMac", "Ssid", SsidValue(Ssid("rr-mu-scheduler")));
+    mac.SetMultiUserScheduler("ns3::RrMultiUserScheduler",
+                              "NStations",
+                              UintegerValue(N_STATIONS),
+                              "DLSchedulerLogic",
+                              StringValue("Mixed"),
+                              "EnableUlOfdma",
+                              BooleanValue(false),
+                              "LookaheadPpdus",
+                              UintegerValue(2));
+    NetDeviceContainer apDevices = wifi.Install(phy, mac, wifiApNode);
+    m_apDevice = DynamicCast<WifiNetDevice>(apDevices.Get(0));
+
+    streamNumber += wifi.AssignStreams(apDevices, streamNumber);
+    streamNumber += wifi.AssignStreams(m_staDevices, streamNumber);
+
+    MobilityHelper mobility;
+    auto positionAlloc = CreateObject<ListPositionAllocator>();
+    positionAlloc->Add(Vector(0.0, 0.0, 0.0));
+    for (std::size_t i = 0; i < N_STATIONS; i++)
+    {
+        positionAlloc->Add(Vector(1.0, 0.0, 0.0));
+    }
+    mobility.SetPositionAllocator(positionAlloc);
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    mobility.Install(wifiApNode);
+    mobility.Install(wifiStaNodes);
+
+    m_apDevice->GetPhy()->TraceConnectWithoutContext(
+        "PhyTxPsduBegin",
+        MakeCallback(&RrMuSchedulerDlPlanTest::Transmit, this));
+
+    // a packet addressed to every station triggers the establishment of a BA agreement
+    for (std::size_t i = 0; i < N_STATIONS; i++)
+    {
+        Simulator::Schedule(Seconds(1), &RrMuSchedulerDlPlanTest::Enqueue, this, i, 1);
+    }
+    // then, the queues of the last stations are filled the most, so that these stations
+    // are ranked first even after being served by a DL MU PPDU
+    m_trafficStart = Seconds(1.5);
+    for (std::size_t i = 0; i < N_STATIONS; i++)
+    {
+        Simulator::Schedule(m_trafficStart,
+                            &RrMuSchedulerDlPlanTest::Enqueue,
+                            this,
+                            i,
+                            (i < N_SMALL_QUEUES ? 10 : 40));
+    }
+
+    Simulator::Stop(Seconds(2));
+    Simulator::Run();
+    Simulator::Destroy();
+
+    std::set<std::size_t> firstGroup;
+    std::set<std::size_t> secondGroup;
+    for (std::size_t i = 0; i < N_STATIONS; i++)
+    {
+        (i < N_SMALL_QUEUES ? secondGroup : firstGroup).insert(i);
+    }
+
+    NS_TEST_ASSERT_MSG_GT_OR_EQ(m_dlMuReceivers.size(), 2, "Expected at least two DL MU PPDUs");
+    NS_TEST_EXPECT_MSG_EQ((m_dlMuReceivers[0] == firstGroup),
+                          true,
+                          "The first DL MU PPDU must be sent to the stations of the first group "
+                          "of the plan, i.e., those having the largest queues");
+    NS_TEST_EXPECT_MSG_EQ((m_dlMuReceivers[1] == secondGroup),
+                          true,
+                          "The second DL MU PPDU must be sent to the stations of the second "
+                          "group of the plan, which were not served by the first DL MU PPDU");
+}
+
+/**
+ * \ingroup wifi-test
+ * \ingroup tests
+ *
+ * \brief RR MU scheduler Test Suite
+ */
+class RrMultiUserSchedulerTestSuite : public TestSuite
+{
+  public:
+    RrMultiUserSchedulerTestSuite();
+};
+
+RrMultiUserSchedulerTestSuite::RrMultiUserSchedulerTestSuite()
+    : TestSuite("wifi-rr-mu-scheduler", UNIT)
+{
+    AddTestCase(new RrMuSchedulerRuPackingTest, TestCase::QUICK);
+    AddTestCase(new RrMuSchedulerDlPlanTest, TestCase::QUICK);
+}
+
+static RrMultiUserSchedulerTestSuite g_rrMultiUserSchedulerTestSuite; ///< the test suite
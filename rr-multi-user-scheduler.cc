@@ -23,7 +23,9 @@
 #include "he-frame-exchange-manager.h"
 #include "he-phy.h"
 
+#include "ns3/double.h"
 #include "ns3/log.h"
+#include "ns3/node.h"
 #include "ns3/wifi-acknowledgment.h"
 #include "ns3/wifi-mac-queue.h"
 #include "ns3/wifi-protection.h"
@@ -51,22 +53,12 @@ NS_LOG_COMPONENT_DEFINE("RrMultiUserScheduler");
 
 NS_OBJECT_ENSURE_REGISTERED(RrMultiUserScheduler);
 
-
-ns3::Time total_bsrp_time = TimeStep(0);
-bool last_tx_bsrp = false;
-ns3::Time bsrp_start = TimeStep(0);
-
-ns3::Time total_basic_time = TimeStep(0);
-bool last_tx_basic = false;
-ns3::Time basic_start = TimeStep(0);
-
-bool bsrp_limit = false;
-int count = 10;
-
-bool prop_scheduler = false;
-
-Time ul_time = Seconds(0);
-
+#ifdef NS3_RR_MU_SCHEDULER_TRACE
+#define RR_MU_TRACE(...) Trace(__VA_ARGS__)
+#else
+/// Arguments are not evaluated if the binary trace is not compiled in
+#define RR_MU_TRACE(...)
+#endif
 
 TypeId
 RrMultiUserScheduler::GetTypeId()
@@ -104,12 +96,22 @@ RrMultiUserScheduler::GetTypeId()
                           MakeBooleanAccessor(&RrMultiUserScheduler::m_enableBsrp),
                           MakeBooleanChecker())
             .AddAttribute("DLSchedulerLogic",
-                          "Standard or Bellalta",
+                          "Standard, Bellalta, Mixed (RUs of different sizes are packed "
+                          "based on the queue size of the stations), PropFair (stations are "
+                          "ranked by the rate of their SU TXVECTOR divided by their average "
+                          "served throughput and RUs are packed based on such ratio) or Edf "
+                          "(stations are ranked by the deadline of their head-of-line frame, "
+                          "i.e., its enqueue time plus the latency budget of its AC, and RUs "
+                          "are packed based on the rate needed to meet the deadline)",
                           StringValue("Standard"),
                           MakeStringAccessor (&RrMultiUserScheduler::m_dlschedulerLogic),
                           MakeStringChecker ())
             .AddAttribute("ULSchedulerLogic",
-                          "Standard or Bellalta",
+                          "Standard, Bellalta, Mixed (RUs of different sizes are packed "
+                          "based on the buffer status reported by the stations) or PropFair "
+                          "(stations are ranked by the rate of their SU TXVECTOR divided by "
+                          "their average served throughput and RUs are packed based on such "
+                          "ratio)",
                           StringValue ("Standard"),
                           MakeStringAccessor (&RrMultiUserScheduler::m_ulschedulerLogic),
                           MakeStringChecker ())
@@ -139,658 +141,516 @@ RrMultiUserScheduler::GetTypeId()
                 "duration (in microseconds) times the allocated bandwidth share",
                 TimeValue(Seconds(1)),
                 MakeTimeAccessor(&RrMultiUserScheduler::m_maxCredits),
-                MakeTimeChecker());
+                MakeTimeChecker())
+            .AddAttribute("PfTimeConstant",
+                          "The time constant of the exponential average of the throughput "
+                          "served to each station, used by the PropFair scheduler logic",
+                          TimeValue(MilliSeconds(100)),
+                          MakeTimeAccessor(&RrMultiUserScheduler::m_pfTimeConstant),
+                          MakeTimeChecker(MicroSeconds(1)))
+            .AddAttribute("LatencyBudgetVo",
+                          "The latency budget of AC_VO frames, used by the Edf scheduler logic",
+                          TimeValue(MilliSeconds(10)),
+                          MakeTimeAccessor(&RrMultiUserScheduler::m_latencyBudgetVo),
+                          MakeTimeChecker(Seconds(0)))
+            .AddAttribute("LatencyBudgetVi",
+                          "The latency budget of AC_VI frames, used by the Edf scheduler logic",
+                          TimeValue(MilliSeconds(50)),
+                          MakeTimeAccessor(&RrMultiUserScheduler::m_latencyBudgetVi),
+                          MakeTimeChecker(Seconds(0)))
+            .AddAttribute("LatencyBudgetBe",
+                          "The latency budget of AC_BE frames, used by the Edf scheduler logic",
+                          TimeValue(MilliSeconds(100)),
+                          MakeTimeAccessor(&RrMultiUserScheduler::m_latencyBudgetBe),
+                          MakeTimeChecker(Seconds(0)))
+            .AddAttribute("LatencyBudgetBk",
+                          "The latency budget of AC_BK frames, used by the Edf scheduler logic",
+                          TimeValue(MilliSeconds(300)),
+                          MakeTimeAccessor(&RrMultiUserScheduler::m_latencyBudgetBk),
+                          MakeTimeChecker(Seconds(0)))
+            .AddAttribute("EdfMinSlack",
+                          "The Edf scheduler logic weighs a station by its queue size divided "
+                          "by the time left before the deadline of its head-of-line frame. "
+                          "Stations whose frames are late, or have less time left than this "
+                          "value, are weighed as if they had this time left",
+                          TimeValue(MicroSeconds(100)),
+                          MakeTimeAccessor(&RrMultiUserScheduler::m_edfMinSlack),
+                          MakeTimeChecker(NanoSeconds(1)))
+            .AddAttribute("LookaheadPpdus",
+                          "The number of DL MU PPDUs planned from one snapshot of the queues. "
+                          "The stations to consider for (and the RU type of) the next DL MU "
+                          "PPDUs are taken from the plan until it is used up or invalidated "
+                          "(1 means that every DL MU PPDU is planned from scratch)",
+                          UintegerValue(1),
+                          MakeUintegerAccessor(&RrMultiUserScheduler::m_lookahead),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("LookaheadThreshold",
+                          "The DL lookahead plan is invalidated if the queue size of a planned "
+                          "station differs from the snapshot by more than this fraction",
+                          DoubleValue(0.5),
+                          MakeDoubleAccessor(&RrMultiUserScheduler::m_lookaheadThreshold),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("UlDurationPolicy",
+                          "How the duration of the TB PPDUs solicited by Basic Trigger Frames is "
+                          "determined: MaxBuffer (every station can transmit the largest buffer "
+                          "status among the solicited stations) or Throughput (the duration "
+                          "maximizes the bytes delivered per unit of TXOP time, based on the "
+                          "buffer status, RU and MCS of each station, and stations that would "
+                          "pad are assigned smaller RUs)",
+                          StringValue("MaxBuffer"),
+                          MakeStringAccessor(&RrMultiUserScheduler::m_ulDurationPolicy),
+                          MakeStringChecker())
+            .AddAttribute("DlUlRatioMode",
+                          "How DL MU PPDUs and UL MU transmissions are interleaved: Off (UL MU "
+                          "is attempted after every DL MU PPDU), Fixed (DlFraction DL MU PPDUs "
+                          "and UlFraction UL MU transmissions per round) or Adaptive (UL MU is "
+                          "attempted while the share of MU airtime used for UL is below the "
+                          "share of the total backlog that is buffered by stations)",
+                          StringValue("Off"),
+                          MakeStringAccessor(&RrMultiUserScheduler::m_dlUlRatioMode),
+                          MakeStringChecker())
+            .AddAttribute("DlFraction",
+                          "The number of DL MU PPDUs per round in the Fixed DL/UL ratio mode",
+                          UintegerValue(10),
+                          MakeUintegerAccessor(&RrMultiUserScheduler::m_dlFraction),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("UlFraction",
+                          "The number of UL MU transmissions (solicited by Basic Trigger Frames) "
+                          "per round in the Fixed DL/UL ratio mode",
+                          UintegerValue(1),
+                          MakeUintegerAccessor(&RrMultiUserScheduler::m_ulFraction),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("DlUlRatioSmoothing",
+                          "The weight of the newest sample when averaging the backlog and the "
+                          "airtime of DL and UL in the Adaptive DL/UL ratio mode",
+                          DoubleValue(0.1),
+                          MakeDoubleAccessor(&RrMultiUserScheduler::m_ratioAlpha),
+                          MakeDoubleChecker<double>(0, 1))
+            .AddAttribute("BsrpPeriod",
+                          "The number of opportunities to send a BSRP Trigger Frame for every "
+                          "BSRP Trigger Frame actually sent (1 means that a BSRP TF is sent at "
+                          "every opportunity)",
+                          UintegerValue(1),
+                          MakeUintegerAccessor(&RrMultiUserScheduler::m_bsrpPeriod),
+                          MakeUintegerChecker<uint32_t>(1))
+#ifdef NS3_RR_MU_SCHEDULER_TRACE
+            .AddAttribute("TraceFile",
+                          "The prefix of the name of the file storing the binary scheduler "
+                          "trace (the node ID and the .bin extension are appended)",
+                          StringValue("rr-mu-scheduler"),
+                          MakeStringAccessor(&RrMultiUserScheduler::m_traceFile),
+                          MakeStringChecker())
+            .AddAttribute("TraceBufferSize",
+                          "The number of trace records buffered before being written to file",
+                          UintegerValue(4096),
+                          MakeUintegerAccessor(&RrMultiUserScheduler::m_traceBufferSize),
+                          MakeUintegerChecker<uint32_t>(1))
+#endif
+        ;
     return tid;
 }
 
-std::vector<HeRu::RuSpec>
-RrMultiUserScheduler::prop_scheduler_fun(std::list<std::pair<std::list<MasterInfo>::iterator, 
-Ptr<WifiMpdu>>> m_candidates, uint16_t ch_width, bool ul){
-    std::vector<HeRu::RuSpec> allocation;
-    std::vector<int> ru_array;
-    //////////////////////////////////////////
-    std::vector<int> queue_array;
-        double queue_sum = 0;
-        if(ul){
-            std::cout << "UL Queue size: ";    
-        }else{
-            std::cout << "DL Queue size: ";
-        }
-        for(auto it: m_candidates){
-            int sz = 0;
-            if(ul) sz = m_apMac->GetMaxBufferStatus(it.first->address);
-            else{
-                sz = (dlqueueinfo.find(*(it.first)))->second;
-            }
-            std::cout << "station: "<< it.first->address << " " << sz << " ";
-            queue_array.push_back(sz);
-            queue_sum += sz;
-        }std::cout << "\n";
+namespace
+{
 
-    if(ch_width == 20){ // 20MHz
-        int total_width = 9;
+/// Number of RU types (from 26-tone to 2x996-tone)
+constexpr std::size_t N_RU_TYPES = HeRu::RU_2x996_TONE + 1;
 
-        std::cout << "queue normal: ";
-        for (int i = 0; i < int(queue_array.size()); i++)
-        {
-            queue_array[i] = int((queue_array[i]/queue_sum)*total_width);
-            std::cout << queue_array[i] << " ";   
-        }std::cout << "\n";
+/**
+ * Tone budget of a channel width, i.e., the RUs available in the channel expressed
+ * in units of 26-tone RUs. A 26-tone unit is identified by the (0-based) position of
+ * the corresponding 26-tone RU in the channel, the units of the secondary 80 MHz
+ * following those of the primary 80 MHz in a 160 MHz channel.
+ */
+struct ToneBudget
+{
+    uint8_t nUnits{0};                //!< number of 26-tone units in the channel
+    uint8_t cost[N_RU_TYPES]{};       //!< number of 26-tone units covered by an RU of each type
+    uint8_t nRus[N_RU_TYPES]{};       //!< number of RUs of each type in the channel
+    uint8_t nRusPer80[N_RU_TYPES]{};  //!< number of RUs of each type in the primary 80 MHz
+    uint8_t firstUnit[N_RU_TYPES][RrMultiUserScheduler::MAX_RUS]{}; //!< first unit of each RU
+    uint8_t lastUnit[N_RU_TYPES][RrMultiUserScheduler::MAX_RUS]{};  //!< last unit of each RU
+    /// (0-based) index of the first RU of each type starting at or after the given unit
+    /// (equal to the number of RUs of that type if no such RU exists)
+    uint8_t nextRu[N_RU_TYPES][RrMultiUserScheduler::MAX_RUS + 1]{};
+
+    /**
+     * \param ruType the RU type
+     * \param index the (0-based) index of an RU of the given type in the channel
+     * \return the RU specification
+     */
+    HeRu::RuSpec GetRu(HeRu::RuType ruType, std::size_t index) const
+    {
+        bool primary80MHz = (index < nRusPer80[ruType]);
+        return {ruType, (primary80MHz ? index : index - nRusPer80[ruType]) + 1, primary80MHz};
+    }
+};
 
-        int ru_106 = 0;
-        int ru_52 = 0;
-        int ru_26 = 0;
+/**
+ * \param bw the channel width (MHz), up to 80 MHz
+ * \param[out] budget the tone budget to fill
+ */
+void
+FillToneBudget(uint16_t bw, ToneBudget& budget)
+{
+    const auto& units = HeRu::m_heRuSubcarrierGroups.at({bw, HeRu::RU_26_TONE});
+    budget.nUnits = units.size();
 
-        for (int i = 0; i < int(queue_array.size()); i++)
+    for (std::size_t t = 0; t < N_RU_TYPES; t++)
+    {
+        auto it = HeRu::m_heRuSubcarrierGroups.find({bw, static_cast<HeRu::RuType>(t)});
+        if (it == HeRu::m_heRuSubcarrierGroups.end())
         {
-            if(ru_array.size() >= 9){
-                break;
-            }
-            if(queue_array[i] == 1){
-                if(ru_26 >= 9){
-                    continue;
-                }
-                ru_array.push_back(26);
-                total_width -=1;
-                ru_26++;
-            }else if(queue_array[i] >= 2 && queue_array[i] < 4){
-                if(ru_52 >= 4){
-                    continue;
-                }
-                ru_array.push_back(52);
-                total_width-=2;
-                ru_52++;
-            }else if(queue_array[i] >= 4 && queue_array[i] < 9){
-                if(ru_106 >= 2){
-                    continue;
-                }
-                ru_array.push_back(106);
-                total_width-=4;
-                ru_106++;
-            }else if(queue_array[i] == 9){
-                ru_array.push_back(242);
-                total_width-=9;
-                break;
-            }
-                        
+            continue;
         }
-        for (int i = 0; i < int(ru_array.size()); i++)
+        budget.nRus[t] = budget.nRusPer80[t] = it->second.size();
+
+        for (std::size_t ru = 0; ru < it->second.size(); ru++)
+        {
+            // a 26-tone unit is covered by the RU if all its subcarrier ranges are
+            // included in one of the subcarrier ranges of the RU
+            bool first = true;
+            for (std::size_t u = 0; u < units.size(); u++)
             {
-                if(ru_array[i] == 106){
-                    if(total_width >= 5){
-                        ru_array[i] = 242;
-                        ru_106--;
-                        break;
+                bool covered = std::all_of(units[u].cbegin(), units[u].cend(), [&](auto&& r) {
+                    return std::any_of(it->second[ru].cbegin(),
+                                       it->second[ru].cend(),
+                                       [&](auto&& s) { return s.first <= r.first && r.second <= s.second; });
+                });
+                if (covered)
+                {
+                    if (first)
+                    {
+                        budget.firstUnit[t][ru] = u;
+                        first = false;
                     }
+                    budget.lastUnit[t][ru] = u;
+                }
+            }
+            NS_ASSERT(!first);
+        }
+        budget.cost[t] = budget.lastUnit[t][0] - budget.firstUnit[t][0] + 1;
+    }
+}
 
-                }else if(ru_array[i] == 52){
-                    if(total_width >= 7){
-                        ru_array[i] = 242;
-                        ru_52--;
-                        break;
-                    }
-                    else if(total_width >= 2){
-                        if(ru_106 >= 2) continue;
-                        ru_array[i] = 106;
-                        ru_106++;
-                        ru_52--;
-                        total_width-=2;
-                    }
+/**
+ * \param bw the channel width (MHz)
+ * \return the tone budget of the given channel width
+ */
+ToneBudget
+BuildToneBudget(uint16_t bw)
+{
+    ToneBudget budget;
 
-                }else if(ru_array[i] == 26){
-                    if(total_width >= 8){
-                        ru_array[i] = 242;
-                        ru_26--;
-                        break;
-                    }
-                    else if(total_width >= 3){
-                        if(ru_106 >= 2) continue;
-                        ru_array[i] = 106;
-                        ru_106++;
-                        ru_26--;
-                        total_width-=3;
-                    }
-                    else if(total_width >= 1){
-                        if(ru_52 >= 4) continue;
-                        ru_array[i] = 52;
-                        ru_52++;
-                        ru_26--;
-                        total_width-=1;
-                    }
+    if (bw < 160)
+    {
+        FillToneBudget(bw, budget);
+    }
+    else
+    {
+        // a 160 MHz channel is made of two 80 MHz channels, the 26-tone units (and the
+        // RU indices) of the secondary 80 MHz following those of the primary 80 MHz
+        ToneBudget budget80;
+        FillToneBudget(80, budget80);
+        budget.nUnits = 2 * budget80.nUnits;
 
-                }
-            }
-        std::cout << "RU array after first correction and before allocation: ";
-        for (int i = 0; i < int(ru_array.size()); i++)
+        for (std::size_t t = 0; t < HeRu::RU_2x996_TONE; t++)
         {
-            std::cout << ru_array[i] << " ";
-        }std::cout << "\n";
-        
-        
-        int start_index = 1;    
-        for (int i = 0; i < int(ru_array.size()); i++)
-        {
-            if(start_index > 9){
-                if(ru_array[i] != 26){
-                    break;
-                }
-            }
-            if(ru_array[i] == 242){
-                if(start_index == 5) start_index++;
-                auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), HeRu::RU_242_TONE, start_index, true);
-                allocation.push_back(*(ruSet.begin()));
-                break;
-            }else if(ru_array[i] == 106){
-                if(start_index + 4 > 10) break;
-                if(start_index == 5) start_index++;
-                int final_index = start_index;
-                if(start_index>=1 && start_index <=4) final_index = 1;
-                if(start_index>=6 && start_index <=9) final_index = 2;
-                auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), HeRu::RU_106_TONE, final_index, true);
-                allocation.push_back(*(ruSet.begin()));
-                start_index+=4;
-            }else if(ru_array[i] == 52){
-                if(start_index + 2 > 10) break;
-                if(start_index == 5) start_index++;
-                int final_index = start_index;
-                if(start_index>=1 && start_index <=2) final_index = 1;
-                if(start_index>=3 && start_index <=4) final_index = 2;
-                if(start_index>=6 && start_index <=7) final_index = 3;
-                if(start_index>=8 && start_index <=9) final_index = 4;
-                auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), HeRu::RU_52_TONE, final_index, true);
-                allocation.push_back(*(ruSet.begin()));
-                start_index+=2;
-            }else{
-                std::cout << "knadsmcjwx" << "\n";
-                if(i == (int(ru_array.size()) -1)){
-                    std::cout << "YESSS" << "\n";
-                    auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), HeRu::RU_26_TONE, 5, true);
-                    allocation.push_back(*(ruSet.begin()));
-                }else{
-                if(start_index + 1 > 10) break;
-                auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), HeRu::RU_26_TONE, start_index, true);
-                allocation.push_back(*(ruSet.begin()));
-                start_index+=1;
+            budget.cost[t] = budget80.cost[t];
+            budget.nRus[t] = 2 * budget80.nRus[t];
+            budget.nRusPer80[t] = budget80.nRus[t];
+            for (std::size_t ru = 0; ru < budget80.nRus[t]; ru++)
+            {
+                for (std::size_t sec80 = 0; sec80 < 2; sec80++)
+                {
+                    budget.firstUnit[t][sec80 * budget80.nRus[t] + ru] =
+                        budget80.firstUnit[t][ru] + sec80 * budget80.nUnits;
+                    budget.lastUnit[t][sec80 * budget80.nRus[t] + ru] =
+                        budget80.lastUnit[t][ru] + sec80 * budget80.nUnits;
                 }
             }
         }
-        
-    ///////////////////////////////////////   
-    }else if(ch_width == 40){ //40MHz
-        int total_width = 18;
-        
-        std::cout << "Queue array: ";
-        for (int i = 0; i < int(queue_array.size()); i++)
+        budget.cost[HeRu::RU_2x996_TONE] = budget.nUnits;
+        budget.nRus[HeRu::RU_2x996_TONE] = budget.nRusPer80[HeRu::RU_2x996_TONE] = 1;
+        budget.firstUnit[HeRu::RU_2x996_TONE][0] = 0;
+        budget.lastUnit[HeRu::RU_2x996_TONE][0] = budget.nUnits - 1;
+    }
+
+    for (std::size_t t = 0; t < N_RU_TYPES; t++)
+    {
+        std::size_t ru = budget.nRus[t];
+        for (std::size_t u = budget.nUnits + 1; u-- > 0;)
         {
-            queue_array[i] = int((queue_array[i]/queue_sum)*total_width);
-            std::cout << queue_array[i] << " ";
-        }std::cout << "\n";
+            while (ru > 0 && budget.firstUnit[t][ru - 1] >= u)
+            {
+                ru--;
+            }
+            budget.nextRu[t][u] = ru;
+        }
+    }
+    return budget;
+}
+
+/**
+ * \param bw the channel width (MHz)
+ * \return the (precomputed) tone budget of the given channel width
+ */
+const ToneBudget&
+GetToneBudget(uint16_t bw)
+{
+    static const ToneBudget budgets[] = {BuildToneBudget(20),
+                                         BuildToneBudget(40),
+                                         BuildToneBudget(80),
+                                         BuildToneBudget(160)};
+    switch (bw)
+    {
+    case 20:
+        return budgets[0];
+    case 40:
+        return budgets[1];
+    case 80:
+        return budgets[2];
+    default:
+        NS_ABORT_MSG_IF(bw != 160, "Unsupported channel width: " << bw);
+        return budgets[3];
+    }
+}
+
+/**
+ * \param bw the channel width (MHz)
+ * \return the maximum number of RUs that can be allocated in the given channel width,
+ *         i.e., the number of 26-tone RUs (9, 18, 37 or 74)
+ */
+std::size_t
+GetMaxNRus(uint16_t bw)
+{
+    return GetToneBudget(bw).nUnits;
+}
+
+} // namespace
 
-        int ru_242 = 0;
-        int ru_106 = 0;
-        int ru_52 = 0;
-        int ru_26 = 0;
+std::size_t
+RrMultiUserScheduler::prop_scheduler_fun(const std::vector<CandidateInfo>& candidates,
+                                         uint16_t ch_width,
+                                         bool ul,
+                                         PropAllocation& allocation)
+{
+    NS_LOG_FUNCTION(this << ch_width << ul);
+
+    const auto& budget = GetToneBudget(ch_width);
+    const std::size_t nStations = std::min(candidates.size(), MAX_RUS);
 
-        for (int i = 0; i < int(queue_array.size()); i++)
+    std::array<double, MAX_RUS> queue;
+    double queueSum = 0;
+    const bool propFair = ((ul ? m_ulschedulerLogic : m_dlschedulerLogic) == "PropFair");
+    const bool edf = (!ul && m_dlschedulerLogic == "Edf");
+    const double minSlack = m_edfMinSlack.GetSeconds();
+
+    auto candidateIt = candidates.cbegin();
+    for (std::size_t i = 0; i < nStations; i++, candidateIt++)
+    {
+        if (propFair)
         {
-            if(ru_array.size() >= 18){
-                break;
-            }
-            
-            if(queue_array[i] == 1){
-                if(ru_26 >= 18){
-                    continue;
-                }
-                ru_array.push_back(26);
-                total_width-=1;
-                ru_26++;
-            }else if(queue_array[i] >= 2 && queue_array[i] < 4){
-                if(ru_52 >= 8){
-                    continue;
-                }
-                ru_array.push_back(52);
-                total_width-=2;
-                ru_52++;
-            }else if(queue_array[i] >= 4 && queue_array[i] < 9){
-                if(ru_106 >= 4){
-                    continue;
-                }
-                ru_array.push_back(106);
-                total_width-=4;
-                ru_106++;
-            }else if(queue_array[i] >= 9 && queue_array[i] < 18){
-                if(ru_242 >= 2){
-                    continue;
-                }
-                ru_array.push_back(242);
-                total_width-=9;
-                ru_242++;
-            }else if(queue_array[i] == 18){
-                ru_array.push_back(484);
-                total_width-=18;
-                break;
-            }  
+            queue[i] = m_staTable[candidateIt->first].pfMetric;
+        }
+        else if (edf)
+        {
+            const auto& info = m_dlStaInfo[candidateIt->first];
+            const double slack = (info.deadline - Simulator::Now()).GetSeconds();
+            queue[i] = info.queueSize / std::max(slack, minSlack);
         }
-        std::cout << "RU array start: ";
-        for(auto it: ru_array){
-            std::cout << it << " ";
+        else if (ul)
+        {
+            queue[i] = m_apMac->GetMaxBufferStatus(m_staTable[candidateIt->first].address);
         }
-        std::cout << "\n";
+        else
+        {
+            queue[i] = m_dlStaInfo[candidateIt->first].queueSize;
+        }
+        NS_LOG_DEBUG("Station " << m_staTable[candidateIt->first].address
+                                << (propFair ? " has PF metric "
+                                             : (edf ? " needs rate (B/s) " : " has queue size "))
+                                << queue[i]);
+        queueSum += queue[i];
+    }
 
-        for (int i = 0; i < int(ru_array.size()); i++)
-            {
-                if(ru_array[i] == 242){
-                    if(total_width >= 9){
-                        ru_array[i] = 484;
-                        ru_242--;
-                        break;
-                    }
-                }
-                else if(ru_array[i] == 106){
-                    if(total_width >= 14){
-                        ru_array[i] = 484;
-                        ru_106--;
-                        break;
-                    }
-                    else if(total_width >= 5){
-                        if(ru_242 >= 2) continue;
-                        ru_array[i] = 242;
-                        ru_242++;
-                        ru_106--;
-                        total_width-=5;
-                    }
+    // Each station demands a share of the tone budget proportional to its queue size
+    // (or PF metric, or rate needed to meet the deadline)
+    ToneDemand demand;
+    for (std::size_t i = 0; i < nStations; i++)
+    {
+        demand[i] = (queueSum > 0 ? static_cast<uint8_t>(queue[i] / queueSum * budget.nUnits)
+                                  : budget.nUnits / nStations);
+    }
 
-                }else if(ru_array[i] == 52){
-                    if(total_width >= 16){
-                        ru_array[i] = 484;
-                        ru_52--;
-                        break;
-                    }
-                    else if(total_width >= 7){
-                        if(ru_242 >= 2) continue;
-                        ru_array[i] = 242;
-                        ru_242++;
-                        ru_52--;
-                        total_width-=7;
-                    }
-                    else if(total_width >= 2){
-                        if(ru_106 >= 4) continue;
-                        ru_array[i] = 106;
-                        ru_106++;
-                        ru_52--;
-                        total_width-=2;
-                    }
+    return PackRus(demand, nStations, ch_width, allocation);
+}
 
-                }else if(ru_array[i] == 26){
-                    if(total_width >= 17){
-                        ru_array[i] = 484;
-                        ru_26--;
-                        break;
-                    }
-                    else if(total_width >= 8){
-                        if(ru_242 >= 2) continue;
-                        ru_array[i] = 242;
-                        ru_242++;
-                        ru_26--;
-                        total_width-=8;
-                    }
-                    else if(total_width >= 3){
-                        if(ru_106 >= 4) continue;
-                        ru_array[i] = 106;
-                        ru_106++;
-                        ru_26--;
-                        total_width-=3;
-                    }
-                    else if(total_width >= 1){
-                        if(ru_52 >= 8) continue;
-                        ru_array[i] = 52;
-                        ru_52++;
-                        ru_26--;
-                        total_width-=1;
-                    }
+std::size_t
+RrMultiUserScheduler::PackRus(const ToneDemand& demand,
+                              std::size_t nStations,
+                              uint16_t ch_width,
+                              PropAllocation& allocation)
+{
+    NS_LOG_FUNCTION(nStations << ch_width);
 
-                }
-            }
-        int start_index = 1; 
-        bool index_14 = false;
-        bool index_5 = false;   
-        for (int i = 0; i < int(ru_array.size()); i++)
+    const auto& budget = GetToneBudget(ch_width);
+    NS_ASSERT(nStations <= MAX_RUS);
+
+    // RU type (or -1 if none) assigned to each candidate station
+    std::array<int8_t, MAX_RUS> ruType;
+
+    // Each station is assigned the largest RU not exceeding its demand
+    uint8_t nAssigned[N_RU_TYPES]{};
+    int remaining = budget.nUnits;
+
+    for (std::size_t i = 0; i < nStations; i++)
+    {
+        allocation[i].reset();
+        ruType[i] = -1;
+        for (int t = N_RU_TYPES - 1; t >= 0; t--)
         {
-            if(start_index > 18){
-                if(ru_array[i] != 26){
-                    break;
-                }
-                
-            }
-            if(ru_array[i] == 484){
-                if(start_index == 5 || start_index == 14) start_index++;
-                auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), HeRu::RU_484_TONE, start_index, true);
-                allocation.push_back(*(ruSet.begin()));
+            if (nAssigned[t] < budget.nRus[t] && budget.cost[t] <= demand[i] &&
+                budget.cost[t] <= remaining)
+            {
+                ruType[i] = t;
+                nAssigned[t]++;
+                remaining -= budget.cost[t];
                 break;
             }
-            else if(ru_array[i] == 242){
-                if(start_index + 9 > 19) break;
-                if(start_index == 5 || start_index == 14) start_index++;
-                int final_index = start_index;
-                if(start_index>=1 && start_index <=9) final_index = 1;
-                if(start_index>=10 && start_index <=18) final_index = 2;
-                auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), HeRu::RU_242_TONE, final_index, true);
-                allocation.push_back(*(ruSet.begin()));
-                start_index+=9; 
-            }else if(ru_array[i] == 106){
-                if(start_index + 4 > 19) break;
-                if(start_index == 5 || start_index == 14) start_index++;
-                int final_index = start_index;
-                if(start_index>=1 && start_index <=4) final_index = 1;
-                if(start_index>=6 && start_index <=9) final_index = 2;
-                if(start_index>=10 && start_index <=13) final_index = 3;
-                if(start_index>=15 && start_index <=18) final_index = 4;
-                auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), HeRu::RU_106_TONE, final_index, true);
-                allocation.push_back(*(ruSet.begin()));
-                start_index+=4;
-            }else if(ru_array[i] == 52){
-                if(start_index + 2 > 19) break;
-                if(start_index == 5 || start_index == 14) start_index++;
-                int final_index = start_index;
-                if(start_index>=1 && start_index <=2) final_index = 1;
-                if(start_index>=3 && start_index <=4) final_index = 2;
-                if(start_index>=6 && start_index <=7) final_index = 3;
-                if(start_index>=8 && start_index <=9) final_index = 4;
-                if(start_index>=10 && start_index <=11) final_index = 5;
-                if(start_index>=12 && start_index <=13) final_index = 6;
-                if(start_index>=15 && start_index <=16) final_index = 7;
-                if(start_index>=17 && start_index <=18) final_index = 8;
-                auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), HeRu::RU_52_TONE, final_index, true);
-                allocation.push_back(*(ruSet.begin()));
-                start_index+=2;
-            }else if(ru_array[i] == 26){
-                if(i == (int(ru_array.size()) -1) || i == (int(ru_array.size()) -2)){
-                    std::cout << "YESSS" << "\n";
-                    int index_26tone = 5;
-                    if(index_5 == false || index_14 == false){
-                    if(index_5 == true){
-                        index_26tone = 14;
-                        index_14 = true;
-                    }else{
-                        index_5 = true;
-                    }
-                    auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), HeRu::RU_26_TONE, index_26tone, true);
-                    allocation.push_back(*(ruSet.begin()));
-                    }
-                    else{
-                        break;
-                    }
-                }else{
-                if(start_index + 1 > 19) break;
-                auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), HeRu::RU_26_TONE, start_index, true);
-                allocation.push_back(*(ruSet.begin()));
-                start_index+=1;
-                }
-            }
         }
-    ///////////////////////////////////
-    }else if(ch_width == 80){ //80MHz
-        int total_width = 37;
-        
-        for (int i = 0; i < int(queue_array.size()); i++)
+    }
+
+    // Use the tones left unassigned due to rounding to enlarge the assigned RUs
+    for (std::size_t i = 0; i < nStations && remaining > 0; i++)
+    {
+        if (ruType[i] < 0)
         {
-            queue_array[i] = int((queue_array[i]/queue_sum)*total_width);
+            continue;
         }
-        
-        int ru_484 = 0;
-        int ru_242 = 0;
-        int ru_106 = 0;
-        int ru_52 = 0;
-        int ru_26 = 0;
-
-        for (int i = 0; i < int(queue_array.size()); i++)
+        for (int t = N_RU_TYPES - 1; t > ruType[i]; t--)
         {
-            if(ru_array.size() >= 37){
+            if (nAssigned[t] < budget.nRus[t] &&
+                budget.cost[t] - budget.cost[ruType[i]] <= remaining)
+            {
+                remaining -= budget.cost[t] - budget.cost[ruType[i]];
+                nAssigned[ruType[i]]--;
+                nAssigned[t]++;
+                ruType[i] = t;
                 break;
             }
-            
-            if(queue_array[i] == 1){
-                if(ru_26 >= 37){
-                    continue;
-                }
-                ru_array.push_back(26);
-                total_width-=1;
-                ru_26++;
-            }else if(queue_array[i] >= 2 && queue_array[i] < 4){
-                if(ru_52 >= 16){
-                    continue;
-                }
-                ru_array.push_back(52);
-                total_width-=2;
-                ru_52++;
-            }else if(queue_array[i] >= 4 && queue_array[i] < 9){
-                if(ru_106 >= 8){
-                    continue;
-                }
-                ru_array.push_back(106);
-                total_width-=4;
-                ru_106++;
-            }else if(queue_array[i] >= 9 && queue_array[i] < 18){
-                if(ru_242 >= 4){
+        }
+    }
+
+    // Stations that did not get an RU (e.g., due to a null demand) get a 26-tone RU,
+    // if any is left once the other RUs are placed
+    for (std::size_t i = 0; i < nStations; i++)
+    {
+        if (ruType[i] < 0)
+        {
+            ruType[i] = HeRu::RU_26_TONE;
+        }
+    }
+
+    // Place the RUs from the largest to the smallest one, so that they are aligned to
+    // their natural boundaries. A station whose RU cannot be placed is downgraded.
+    // Every placed RU is checked against the occupancy mask of the RUs placed so far.
+    // HE-SIG-B constrains the packing of RUs smaller than 242 tones:
+    // - the RU_ALLOCATION subfield of a 20 MHz subchannel (as derived by the TXVECTOR)
+    //   can only signal RUs of one type, hence RUs of different types are placed in
+    //   distinct subchannels;
+    // - user fields are mapped to the signaled RUs in order, hence unassigned RUs are
+    //   only allowed in the last used subchannel, which is filled with the smallest RUs;
+    // - the center 26-tone RU of an 80 MHz channel is not signaled by RU_ALLOCATION,
+    //   hence it is never assigned.
+    const std::size_t nSubchannels = budget.nRus[HeRu::RU_242_TONE];
+    HeRu::RuMask occupied;
+    std::size_t cursor = 0;
+    std::size_t nServed = 0;
+
+    for (int t = N_RU_TYPES - 1; t >= 0; t--)
+    {
+        if (t >= HeRu::RU_242_TONE)
+        {
+            for (std::size_t i = 0; i < nStations; i++)
+            {
+                if (ruType[i] != t)
+                {
                     continue;
                 }
-                ru_array.push_back(242);
-                total_width-=9;
-                ru_242++;
-            }else if(queue_array[i] >= 18 && queue_array[i] < 37){
-                if(ru_484 >= 2){
+                std::size_t ru = budget.nextRu[t][cursor];
+                if (ru == budget.nRus[t])
+                {
+                    ruType[i] = t - 1;
                     continue;
                 }
-                ru_array.push_back(484);
-                total_width-=18;
-                ru_484++;
-            }else if(queue_array[i] == 37){
-                ru_array.push_back(996);
-                total_width-=37;
-                break;
+                allocation[i] = budget.GetRu(static_cast<HeRu::RuType>(t), ru);
+                const auto mask = HeRu::GetRuMask(ch_width, *allocation[i]);
+                NS_ASSERT_MSG(!occupied.Overlaps(mask), "RU " << *allocation[i] << " overlaps");
+                occupied |= mask;
+                cursor = budget.lastUnit[t][ru] + 1;
+                nServed++;
             }
+            continue;
         }
-        for (int i = 0; i < int(ru_array.size()); i++)
-            {
-                if(ru_array[i] == 484){
-                    if(total_width >= 19){
-                        ru_array[i] = 996;
-                        ru_484--;
-                        break;
-                    }
-                }
-                else if(ru_array[i] == 242){
-                    if(total_width >= 28){
-                        ru_array[i] = 996;
-                        ru_242--;
-                        break;
-                    }
-                    else if(total_width >= 9){
-                        if(ru_484 >= 2) continue;
-                        ru_array[i] = 484;
-                        ru_484++;
-                        ru_242--;
-                        total_width-=9;
-                    }
-                }
-                else if(ru_array[i] == 106){
-                    if(total_width >= 33){
-                        ru_array[i] = 996;
-                        ru_106--;
-                        break;
-                    }
-                    else if(total_width >= 14){
-                        if(ru_242 >= 2) continue;
-                        ru_array[i] = 484;
-                        ru_484++;
-                        ru_106--;
-                        total_width-=14;
-                    }
-                    else if(total_width >= 5){
-                        if(ru_242 >= 4) continue;
-                        ru_array[i] = 242;
-                        ru_242++;
-                        ru_106--;
-                        total_width-=5;
-                    }
 
-                }else if(ru_array[i] == 52){
-                    if(total_width >= 35){
-                        ru_array[i] = 996;
-                        ru_52--;
-                        break;
-                    }
-                    else if(total_width >= 16){
-                        if(ru_484 >= 2) continue;
-                        ru_array[i] = 484;
-                        ru_484++;
-                        ru_52--;
-                        total_width-=16;
-                    }
-                    else if(total_width >= 7){
-                        if(ru_242 >= 4) continue;
-                        ru_array[i] = 242;
-                        ru_242++;
-                        ru_52--;
-                        total_width-=7;
-                    }
-                    else if(total_width >= 2){
-                        if(ru_106 >= 8) continue;
-                        ru_array[i] = 106;
-                        ru_106++;
-                        ru_52--;
-                        total_width-=2;
-                    }
+        const auto ruTypeT = static_cast<HeRu::RuType>(t);
+        const std::size_t nPerSubchannel = HeRu::GetNRus(20, ruTypeT);
+        std::size_t nOfType = 0;
+        bool smaller = false;
+        for (std::size_t i = 0; i < nStations; i++)
+        {
+            nOfType += (ruType[i] == t ? 1 : 0);
+            smaller = smaller || (ruType[i] >= 0 && ruType[i] < t);
+        }
+        // unless RUs of this type are the smallest ones, the stations that would not fill
+        // a subchannel are downgraded (the last ones in the list of candidates)
+        for (std::size_t i = nStations, n = (smaller ? nOfType % nPerSubchannel : 0); n > 0;)
+        {
+            if (ruType[--i] == t)
+            {
+                ruType[i] = t - 1;
+                n--;
+            }
+        }
 
-                }else if(ru_array[i] == 26){
-                    if(total_width >= 36){
-                        ru_array[i] = 996;
-                        ru_26--;
-                        break;
-                    }
-                    else if(total_width >= 17){
-                        if(ru_484 >= 2) continue;
-                        ru_array[i] = 484;
-                        ru_484++;
-                        ru_26--;
-                        total_width -= 17;
-                    }
-                    else if(total_width >= 8){
-                        if(ru_242 >= 4) continue;
-                        ru_array[i] = 242;
-                        ru_242++;
-                        ru_26--;
-                        total_width-=8;
-                    }
-                    else if(total_width >= 3){
-                        if(ru_106 >= 8) continue;
-                        ru_array[i] = 106;
-                        ru_106++;
-                        ru_26--;
-                        total_width-=3;
-                    }
-                    else if(total_width >= 1){
-                        if(ru_52 >= 16) continue;
-                        ru_array[i] = 52;
-                        ru_52++;
-                        ru_26--;
-                        total_width-=1;
-                    }
+        // first subchannel left free by the larger RUs
+        std::size_t subchannel = 0;
+        while (subchannel < nSubchannels && budget.firstUnit[HeRu::RU_242_TONE][subchannel] < cursor)
+        {
+            subchannel++;
+        }
+        std::size_t slot = 0;
 
-                }
-            }
-        int start_index = 1;    
-        for (int i = 0; i < int(ru_array.size()); i++)
+        for (std::size_t i = 0; i < nStations && subchannel < nSubchannels; i++)
         {
-            if(start_index > 37){
-                break;
-            }
-            if(ru_array[i] == 996){
-                if(start_index == 5 || start_index == 14 || start_index == 19 || start_index == 24 || start_index == 33) start_index++;
-                auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), HeRu::RU_996_TONE, start_index, true);
-                allocation.push_back(*(ruSet.begin()));
-                break;
+            if (ruType[i] != t)
+            {
+                continue;
             }
-            else if(ru_array[i] == 484){
-                if(start_index + 18 > 38) break;
-                if(start_index == 5 || start_index == 14 || start_index == 19 || start_index == 24 || start_index == 33) start_index++;
-                int final_index = start_index;
-                if(start_index>=1 && start_index <=18) final_index = 1;
-                if(start_index>=20 && start_index <=37) final_index = 2;
-                auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), HeRu::RU_484_TONE, final_index, true);
-                allocation.push_back(*(ruSet.begin()));
-                start_index+=18;
-                }
-            else if(ru_array[i] == 242){
-                if(start_index + 9 > 38) break;
-                if(start_index == 5 || start_index == 14 || start_index == 19 || start_index == 24 || start_index == 33) start_index++;
-                int final_index = start_index;
-                if(start_index>=1 && start_index <=9) final_index = 1;
-                if(start_index>=10 && start_index <=18) final_index = 2;
-                if(start_index>=20 && start_index <=28) final_index = 3;
-                if(start_index>=29 && start_index <=37) final_index = 4;
-                auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), HeRu::RU_242_TONE, final_index, true);
-                allocation.push_back(*(ruSet.begin()));
-                start_index+=9; 
-            }else if(ru_array[i] == 106){
-                if(start_index + 4 > 38) break;
-                if(start_index == 5 || start_index == 14 || start_index == 19 || start_index == 24 || start_index == 33) start_index++;
-                int final_index = start_index;
-                if(start_index>=1 && start_index <=4) final_index = 1;
-                if(start_index>=6 && start_index <=9) final_index = 2;
-                if(start_index>=10 && start_index <=13) final_index = 3;
-                if(start_index>=15 && start_index <=18) final_index = 4;
-                if(start_index>=20 && start_index <=23) final_index = 5;
-                if(start_index>=25 && start_index <=28) final_index = 6;
-                if(start_index>=29 && start_index <=32) final_index = 7;
-                if(start_index>=34 && start_index <=37) final_index = 8;
-                auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), HeRu::RU_106_TONE, final_index, true);
-                allocation.push_back(*(ruSet.begin()));
-                start_index+=4;
-            }else if(ru_array[i] == 52){
-                if(start_index + 2 > 38) break;
-                if(start_index == 5 || start_index == 14 || start_index == 19 || start_index == 24 || start_index == 33) start_index++;
-                int final_index = start_index;
-                if(start_index>=1 && start_index <=2) final_index = 1;
-                if(start_index>=3 && start_index <=4) final_index = 2;
-                if(start_index>=6 && start_index <=7) final_index = 3;
-                if(start_index>=8 && start_index <=9) final_index = 4;
-                if(start_index>=10 && start_index <=11) final_index = 5;
-                if(start_index>=12 && start_index <=13) final_index = 6;
-                if(start_index>=15 && start_index <=16) final_index = 7;
-                if(start_index>=17 && start_index <=18) final_index = 8;
-                if(start_index>=20 && start_index <=21) final_index = 9;
-                if(start_index>=22 && start_index <=23) final_index = 10;
-                if(start_index>=25 && start_index <=26) final_index = 11;
-                if(start_index>=27 && start_index <=28) final_index = 12;
-                if(start_index>=29 && start_index <=30) final_index = 13;
-                if(start_index>=31 && start_index <=32) final_index = 14;
-                if(start_index>=34 && start_index <=35) final_index = 15;
-                if(start_index>=36 && start_index <=37) final_index = 16;
-                auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), HeRu::RU_52_TONE, final_index, true);
-                allocation.push_back(*(ruSet.begin()));
-                start_index+=2;
-            }else if(ru_array[i] == 26){
-                if(start_index + 1 > 38) break;
-                auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), HeRu::RU_26_TONE, start_index, true);
-                allocation.push_back(*(ruSet.begin()));
-                start_index+=1;
+            const std::size_t ru =
+                budget.nextRu[t][budget.firstUnit[HeRu::RU_242_TONE][subchannel]] + slot;
+            allocation[i] = budget.GetRu(ruTypeT, ru);
+            const auto mask = HeRu::GetRuMask(ch_width, *allocation[i]);
+            NS_ASSERT_MSG(!occupied.Overlaps(mask), "RU " << *allocation[i] << " overlaps");
+            occupied |= mask;
+            nServed++;
+            if (++slot == nPerSubchannel)
+            {
+                slot = 0;
+                subchannel++;
             }
         }
+        if (slot > 0)
+        {
+            subchannel++;
+        }
+        cursor = (subchannel < nSubchannels ? budget.firstUnit[HeRu::RU_242_TONE][subchannel]
+                                            : budget.nUnits);
     }
-    std::cout << "RU array: ";
-    for(auto it: ru_array){
-        std::cout << it << " ";
-    }
-    std::cout << "\n";
 
-    std::cout << "RU allocation: ";
-    for(auto it: allocation){
-        std::cout << it << " "; 
-    }
-    std::cout << "\n";
-    
-    return allocation;
+    NS_LOG_DEBUG(nServed << " out of " << nStations << " stations are assigned an RU");
+    return nServed;
 }
 
 RrMultiUserScheduler::RrMultiUserScheduler()
@@ -814,10 +674,6 @@ RrMultiUserScheduler::DoInitialize()
     m_apMac->TraceConnectWithoutContext(
         "DeAssociatedSta",
         MakeCallback(&RrMultiUserScheduler::NotifyStationDeassociated, this));
-    for (const auto& ac : wifiAcList)
-    {
-        m_staListDl.insert({ac.first, {}});
-    }
     MultiUserScheduler::DoInitialize();
 }
 
@@ -825,10 +681,23 @@ void
 RrMultiUserScheduler::DoDispose()
 {
     NS_LOG_FUNCTION(this);
-    m_staListDl.clear();
+    for (auto& staList : m_staListDl)
+    {
+        staList.clear();
+    }
     m_staListUl.clear();
+    m_staTable.clear();
+    m_creditOffset.fill(0);
     m_candidates.clear();
+    m_dlStaInfo.clear();
+    m_dlRanking.clear();
+    m_dlRankingSorted = 0;
+    m_dlPlan = DlPlan();
     m_txParams.Clear();
+#ifdef NS3_RR_MU_SCHEDULER_TRACE
+    FlushTrace();
+    m_traceStream.close();
+#endif
     m_apMac->TraceDisconnectWithoutContext(
         "AssociatedSta",
         MakeCallback(&RrMultiUserScheduler::NotifyStationAssociated, this));
@@ -842,66 +711,72 @@ RrMultiUserScheduler::DoDispose()
 MultiUserScheduler::TxFormat
 RrMultiUserScheduler::SelectTxFormat()
 {
-    // std::cout << "At time "<< Simulator::Now()<<" SelectTxFormat called"<<"\n";
-    if(last_tx_bsrp){
-        total_bsrp_time += (Simulator::Now() - bsrp_start);
-        // std::cout << "duration bsrp: "<<(Simulator::Now() - bsrp_start)<<"\n";
-        // std::cout << "Total BSRP time: "<< total_bsrp_time <<"\n";
-    }
-    last_tx_bsrp = false;
+    NS_LOG_FUNCTION(this);
 
-    if(last_tx_basic){
-        total_basic_time += (Simulator::Now() - basic_start);
-        // std::cout << "duration basic" <<(Simulator::Now() - bsrp_start)<<"\n";
-        // std::cout << "Total BASIC time: "<< total_basic_time <<"\n";
+    // the TF exchange started by the previous invocation (if any) is over
+    if (m_lastTxBsrp)
+    {
+        m_metrics.bsrpTime += Simulator::Now() - m_lastTxStart;
     }
-    last_tx_basic = false;
-
-    
-    NS_LOG_FUNCTION(this);
+    else if (m_lastTxBasic)
+    {
+        m_metrics.basicTime += Simulator::Now() - m_lastTxStart;
+    }
+    m_lastTxBsrp = false;
+    m_lastTxBasic = false;
 
     Ptr<const WifiMpdu> mpdu = m_edca->PeekNextMpdu(m_linkId);
-    // std::cout << "linkId: "<< unsigned(m_linkId) <<"\n";
-
-    // if(!mpdu) std::cout << "mpdu zero in selecttx"<<"\n";
 
     if (mpdu && !m_apMac->GetHeSupported(mpdu->GetHeader().GetAddr1()))
     {
         return SU_TX;
     }
 
+    const bool ulMuAllowed = IsUlMuAllowed();
+
     if (m_enableUlOfdma && m_enableBsrp && (GetLastTxFormat(m_linkId) == DL_MU_TX || !mpdu) && 
-    (m_trigger.GetType() != TriggerFrameType::BSRP_TRIGGER))
+    (m_trigger.GetType() != TriggerFrameType::BSRP_TRIGGER) && ulMuAllowed)
     {
-        TxFormat txFormat = TrySendingBsrpTf();
-
-        if (txFormat != DL_MU_TX)
+        // only one out of m_bsrpPeriod opportunities is used to send a BSRP TF. Skipping
+        // an opportunity is decided before preparing the BSRP TF, so that the Trigger
+        // Frame and the TX parameters are left untouched
+        if (m_bsrpCount > 1)
         {
+            m_bsrpCount--;
+            NS_LOG_DEBUG("BSRP TF opportunity skipped (" << m_bsrpCount << " left)");
+        }
+        else
+        {
+            TxFormat txFormat = TrySendingBsrpTf();
 
-            if(bsrp_limit){
-                count--;
-                if(count <= 0){
-                    count = 10;
-                    return txFormat;
-                }
-
-            }else{
-                last_tx_bsrp = true;
-                bsrp_start = Simulator::Now();
+            if (txFormat == UL_MU_TX)
+            {
+                // the period restarts only when a BSRP TF is actually sent
+                m_bsrpCount = m_bsrpPeriod;
+                m_lastTxBsrp = true;
+                m_lastTxStart = Simulator::Now();
+                ++m_metrics.nBsrpTfs;
+            }
+            if (txFormat != DL_MU_TX)
+            {
                 return txFormat;
             }
         }
     }
     else if (m_enableUlOfdma && ((GetLastTxFormat(m_linkId) == DL_MU_TX) ||
-                                 (m_trigger.GetType() == TriggerFrameType::BSRP_TRIGGER) || !mpdu))
+                                 (m_trigger.GetType() == TriggerFrameType::BSRP_TRIGGER) || !mpdu) &&
+             ulMuAllowed)
     {
         TxFormat txFormat = TrySendingBasicTf();
 
+        if (txFormat == UL_MU_TX)
+        {
+            m_lastTxBasic = true;
+            m_lastTxStart = Simulator::Now();
+            ++m_metrics.nBasicTfs;
+        }
         if (txFormat != DL_MU_TX)
         {
-            last_tx_basic = true;
-            basic_start = Simulator::Now();
-            
             return txFormat;
         }
     }
@@ -909,13 +784,142 @@ RrMultiUserScheduler::SelectTxFormat()
     return TrySendingDlMuPpdu();
 }
 
+const RrMultiUserScheduler::Metrics&
+RrMultiUserScheduler::GetMetrics() const
+{
+    return m_metrics;
+}
+
+void
+RrMultiUserScheduler::ResetMetrics()
+{
+    NS_LOG_FUNCTION(this);
+    m_metrics = Metrics();
+}
+
+#ifdef NS3_RR_MU_SCHEDULER_TRACE
+namespace
+{
+
+/**
+ * \param ru the given RU
+ * \return the encoding of the given RU in the binary scheduler trace
+ */
+uint32_t
+EncodeRu(const HeRu::RuSpec& ru)
+{
+    return (ru.GetPrimary80MHz() << 15) | (ru.GetRuType() << 8) | ru.GetIndex();
+}
+
+} // namespace
+
+void
+RrMultiUserScheduler::Trace(TraceEvent event, uint16_t aid, uint32_t arg0, int64_t arg1)
+{
+    if (m_traceBuffer.capacity() == 0)
+    {
+        m_traceBuffer.reserve(m_traceBufferSize);
+    }
+    m_traceBuffer.push_back({Simulator::Now().GetNanoSeconds(), event, aid, arg0, arg1});
+    if (m_traceBuffer.size() >= m_traceBufferSize)
+    {
+        FlushTrace();
+    }
+}
+
+void
+RrMultiUserScheduler::FlushTrace()
+{
+    if (m_traceBuffer.empty())
+    {
+        return;
+    }
+    if (!m_traceStream.is_open())
+    {
+        auto name =
+            m_traceFile + "-" + std::to_string(m_apMac->GetDevice()->GetNode()->GetId()) + ".bin";
+        m_traceStream.open(name, std::ios::binary | std::ios::trunc);
+        NS_ABORT_MSG_IF(!m_traceStream, "Cannot open scheduler trace file " << name);
+    }
+    m_traceStream.write(reinterpret_cast<const char*>(m_traceBuffer.data()),
+                        m_traceBuffer.size() * sizeof(TraceRecord));
+    m_traceBuffer.clear();
+}
+#endif
+
+bool
+RrMultiUserScheduler::IsUlMuAllowed()
+{
+    NS_LOG_FUNCTION(this);
+
+    if (m_dlUlRatioMode == "Fixed")
+    {
+        if (m_dlCount == 0 && m_ulCount == 0)
+        {
+            // start a new round
+            NS_ABORT_MSG_IF(m_dlFraction == 0 && m_ulFraction == 0,
+                            "DlFraction and UlFraction cannot be both zero");
+            m_dlCount = m_dlFraction;
+            m_ulCount = m_ulFraction;
+        }
+        NS_LOG_DEBUG("DL MU PPDUs left: " << m_dlCount << ", UL MU left: " << m_ulCount);
+        return m_ulCount > 0;
+    }
+
+    if (m_dlUlRatioMode == "Adaptive")
+    {
+        const double backlog = m_dlBacklog + m_ulBacklog;
+        const double airtime = m_dlAirtime + m_ulAirtime;
+        if (backlog <= 0 || airtime <= 0)
+        {
+            return true;
+        }
+        NS_LOG_DEBUG("UL share of airtime: " << m_ulAirtime / airtime
+                                             << ", of backlog: " << m_ulBacklog / backlog);
+        return m_ulAirtime / airtime <= m_ulBacklog / backlog;
+    }
+
+    NS_ABORT_MSG_IF(m_dlUlRatioMode != "Off", "Unknown DL/UL ratio mode: " << m_dlUlRatioMode);
+    return true;
+}
+
+void
+RrMultiUserScheduler::NotifyMuTx(bool ul, Time txDuration)
+{
+    NS_LOG_FUNCTION(this << ul << txDuration);
+
+    auto& left = (ul ? m_ulCount : m_dlCount);
+    if (left > 0)
+    {
+        left--;
+    }
+
+    // exponentially weighted airtime of DL and UL MU transmissions
+    m_dlAirtime *= (1 - m_ratioAlpha);
+    m_ulAirtime *= (1 - m_ratioAlpha);
+    (ul ? m_ulAirtime : m_dlAirtime) += m_ratioAlpha * txDuration.GetMicroSeconds();
+}
+
+void
+RrMultiUserScheduler::NotifyNoDlMuTx()
+{
+    NS_LOG_FUNCTION(this);
+    m_dlCount = 0;
+}
+
+void
+RrMultiUserScheduler::NotifyBacklog(bool ul, double bytes)
+{
+    auto& backlog = (ul ? m_ulBacklog : m_dlBacklog);
+    backlog = (1 - m_ratioAlpha) * backlog + m_ratioAlpha * bytes;
+}
+
 template <class Func>
 WifiTxVector
 RrMultiUserScheduler::GetTxVectorForUlMu(Func canBeSolicited, bool isbasictf)
 {
 
     if(isbasictf){// Basic TF
-    // std::cout << "At time "<< Simulator::Now()<<" GetTxVectorForUlMu called"<<"\n";
     NS_LOG_FUNCTION(this);
 
     bool scheduler_x = true; // rr
@@ -924,24 +928,10 @@ RrMultiUserScheduler::GetTxVectorForUlMu(Func canBeSolicited, bool isbasictf)
 
 
     // determine RUs to allocate to stations
-    // std::cout << "m_staListUL size: "<<m_staListUl.size() <<"\n";
     auto count = std::min<std::size_t>(m_nStations, m_staListUl.size());
     std::size_t nCentral26TonesRus;
-    std::size_t limit = 9;
-
-    if(m_apMac->GetWifiPhy()->GetChannelWidth() == 20){
-        limit = 9;
-    }else if(m_apMac->GetWifiPhy()->GetChannelWidth() == 40){
-        limit = 18;
-    }else if(m_apMac->GetWifiPhy()->GetChannelWidth() == 80){
-        limit = 37;
-    }else if(m_apMac->GetWifiPhy()->GetChannelWidth() == 160){
-        limit = 74;
-    }
-
+    const std::size_t limit = GetMaxNRus(m_apMac->GetWifiPhy()->GetChannelWidth());
     count = std::min(count, limit);
-    std::cout << "width: "<<m_allowedWidth <<"\n";
-    std::cout << "width in apmac: "<< m_apMac->GetWifiPhy()->GetChannelWidth() << "\n";
     HeRu::GetEqualSizedRusForStations(m_apMac->GetWifiPhy()->GetChannelWidth(), count, nCentral26TonesRus, scheduler_x);
     NS_ASSERT(count >= 1);
 
@@ -960,38 +950,40 @@ RrMultiUserScheduler::GetTxVectorForUlMu(Func canBeSolicited, bool isbasictf)
     txVector.SetBssColor(heConfiguration->GetBssColor());
 
     if(m_enableBsrp){
-    m_staListUl.sort([this](const MasterInfo& a, const MasterInfo& b) { 
-
-        return (m_apMac->GetMaxBufferStatus((a.address)) > m_apMac->GetMaxBufferStatus((b.address))); });
+    std::stable_sort(m_staListUl.begin(), m_staListUl.end(), [this](uint16_t a, uint16_t b) {
+        return m_apMac->GetMaxBufferStatus(m_staTable[a].address) >
+               m_apMac->GetMaxBufferStatus(m_staTable[b].address);
+    });
     }
 
     // iterate over the associated stations until an enough number of stations is identified
     auto staIt = m_staListUl.begin();
     m_candidates.clear();
 
-    //ulCandidates.clear();
-// txVector.GetHeMuUserInfoMap().size() <
-//                std::min<std::size_t>(m_nStations, count + nCentral26TonesRus)
     while (staIt != m_staListUl.end())
     {
-        NS_LOG_DEBUG("Next candidate STA (MAC=" << staIt->address << ", AID=" << staIt->aid << ")");
-        std::cout<<" Address : "<<staIt->address<<" has buffer "<<unsigned(m_apMac->GetMaxBufferStatus(staIt->address))<<"\n";
-        
+        uint16_t aid = *staIt;
+        const auto& address = m_staTable[aid].address;
+        NS_LOG_DEBUG("Next candidate STA (MAC=" << address << ", AID=" << aid << ")");
+        RR_MU_TRACE(TRACE_UL_BUFFER_STATUS,
+                    aid,
+                    m_apMac->GetMaxBufferStatus(address));
+
         if(m_enableBsrp){
-            auto x = m_apMac->GetMaxBufferStatus(staIt->address);
+            auto x = m_apMac->GetMaxBufferStatus(address);
             if((x == 0)) { staIt++; continue;}
         }
 
-        if (!canBeSolicited(*staIt))
+        if (!canBeSolicited(aid))
         {
-            std::cout << "skipping station: "<<staIt->address << "in UL"<<"\n";
+            RR_MU_TRACE(TRACE_UL_STA_SKIPPED, aid);
             NS_LOG_DEBUG("Skipping station based on provided function object");
             staIt++;
             continue;
         }
 
         if (txVector.GetPreambleType() == WIFI_PREAMBLE_EHT_TB &&
-            !m_apMac->GetEhtSupported(staIt->address))
+            !m_apMac->GetEhtSupported(address))
         {
             NS_LOG_DEBUG(
                 "Skipping non-EHT STA because this Trigger Frame is only soliciting EHT STAs");
@@ -1004,7 +996,7 @@ RrMultiUserScheduler::GetTxVectorForUlMu(Func canBeSolicited, bool isbasictf)
         {
             // check that a BA agreement is established with the receiver for the
             // considered TID, since ack sequences for UL MU require block ack
-            if (m_apMac->GetBaAgreementEstablishedAsRecipient(staIt->address, tid))
+            if (m_apMac->GetBaAgreementEstablishedAsRecipient(address, tid))
             {
                 break;
             }
@@ -1012,7 +1004,7 @@ RrMultiUserScheduler::GetTxVectorForUlMu(Func canBeSolicited, bool isbasictf)
         }
         if (tid == 8)
         {
-            NS_LOG_DEBUG("No Block Ack agreement established with " << staIt->address);
+            NS_LOG_DEBUG("No Block Ack agreement established with " << address);
             staIt++;
             continue;
         }
@@ -1020,7 +1012,7 @@ RrMultiUserScheduler::GetTxVectorForUlMu(Func canBeSolicited, bool isbasictf)
         // if the first candidate STA is an EHT STA, we switch to soliciting EHT TB PPDUs
         if (txVector.GetHeMuUserInfoMap().empty())
         {
-            if (m_apMac->GetEhtSupported() && m_apMac->GetEhtSupported(staIt->address))
+            if (m_apMac->GetEhtSupported() && m_apMac->GetEhtSupported(address))
             {
                 txVector.SetPreambleType(WIFI_PREAMBLE_EHT_TB);
                 txVector.SetEhtPpduType(0);
@@ -1032,22 +1024,22 @@ RrMultiUserScheduler::GetTxVectorForUlMu(Func canBeSolicited, bool isbasictf)
         // just for the purpose of retrieving the TXVECTOR used to transmit to that station
         WifiMacHeader hdr(WIFI_MAC_QOSDATA);
         hdr.SetAddr1(GetWifiRemoteStationManager(m_linkId)
-                         ->GetAffiliatedStaAddress(staIt->address)
-                         .value_or(staIt->address));
+                         ->GetAffiliatedStaAddress(address)
+                         .value_or(address));
         hdr.SetAddr2(m_apMac->GetFrameExchangeManager(m_linkId)->GetAddress());
         WifiTxVector suTxVector =
             GetWifiRemoteStationManager(m_linkId)->GetDataTxVector(hdr, m_apMac->GetWifiPhy()->GetChannelWidth());
-        txVector.SetHeMuUserInfo(staIt->aid,
+        txVector.SetHeMuUserInfo(aid,
                                  {HeRu::RuSpec(), // assigned later by FinalizeTxVector
                                   suTxVector.GetMode().GetMcsValue(),
                                   suTxVector.GetNss()});
+        if (m_ulschedulerLogic == "PropFair")
+        {
+            m_staTable[aid].pfMetric = GetPfMetric(aid, true, suTxVector);
+        }
 
 
-        m_candidates.emplace_back(staIt, nullptr);
-        // AcIndex ac = QosUtilsMapTidToAc(tid);
-            
-        // mpdu = m_apMac->GetQosTxop(ac)->PeekNextMpdu(m_linkId, tid, staIt->address);
-        // m_candidates.emplace_back(staIt, mpdu);
+        m_candidates.emplace_back(aid, nullptr);
 
         // move to the next station in the list
         staIt++;
@@ -1056,40 +1048,23 @@ RrMultiUserScheduler::GetTxVectorForUlMu(Func canBeSolicited, bool isbasictf)
     if (txVector.GetHeMuUserInfoMap().empty())
     {
         NS_LOG_DEBUG("No suitable station");
-        // std::cout << "No suitable station"<<"\n";
         return txVector;
     }
-    // std::cout << "finaltx called for UL"<<"\n";
     FinalizeTxVector(txVector, m_ulschedulerLogic, true, true);
     return txVector;
 
 //////////////////////////////////////////////////////////////////
     }else{//BSRP TF
-        std::cout << "At time "<< Simulator::Now()<<" GetTxVectorForUlMu called"<<"\n";
     NS_LOG_FUNCTION(this);
 
     bool scheduler_x = false; // always keep equal split so all stations respond
     
     // determine RUs to allocate to stations
-    std::cout << "m_staListUL size: "<<m_staListUl.size() <<"\n";
     auto count = std::min<std::size_t>(m_nStations, m_staListUl.size());
     std::size_t nCentral26TonesRus;
-    std::size_t limit = 9;
-    if(m_apMac->GetWifiPhy()->GetChannelWidth() == 20){
-        limit = 9;
-    }else if(m_apMac->GetWifiPhy()->GetChannelWidth() == 40){
-        limit = 18;
-    }else if(m_apMac->GetWifiPhy()->GetChannelWidth() == 80){
-        limit = 37;
-    }else if(m_apMac->GetWifiPhy()->GetChannelWidth() == 160){
-        limit = 74;
-    }
-    std::cout << "count1: "<< count<<"\n";
+    const std::size_t limit = GetMaxNRus(m_apMac->GetWifiPhy()->GetChannelWidth());
     count = std::min(limit, count);
-    std::cout << "width: "<<m_allowedWidth <<"\n";
-    std::cout << "width in apmac: "<< m_apMac->GetWifiPhy()->GetChannelWidth() << "\n";
     HeRu::GetEqualSizedRusForStations(m_apMac->GetWifiPhy()->GetChannelWidth(), count, nCentral26TonesRus, scheduler_x);
-    std::cout << "count2: "<< count<<"\n";
     NS_ASSERT(count >= 1);
 
     if (!m_useCentral26TonesRus)
@@ -1110,23 +1085,20 @@ RrMultiUserScheduler::GetTxVectorForUlMu(Func canBeSolicited, bool isbasictf)
     auto staIt = m_staListUl.begin();
     m_candidates.clear();
 
-    //ulCandidates.clear();
-// txVector.GetHeMuUserInfoMap().size() <
-//                std::min<std::size_t>(m_nStations, count + nCentral26TonesRus)
     while (staIt != m_staListUl.end())
     {
-        NS_LOG_DEBUG("Next candidate STA (MAC=" << staIt->address << ", AID=" << staIt->aid << ")");
-        // std::cout<<" Address : "<<staIt->address<<" has buffer "<<unsigned(m_apMac->GetMaxBufferStatus(staIt->address))<<"\n";
-        if (!canBeSolicited(*staIt))
+        uint16_t aid = *staIt;
+        const auto& address = m_staTable[aid].address;
+        NS_LOG_DEBUG("Next candidate STA (MAC=" << address << ", AID=" << aid << ")");
+        if (!canBeSolicited(aid))
         {
-            // std::cout << "skipping station: "<<staIt->address << "in UL"<<"\n";
             NS_LOG_DEBUG("Skipping station based on provided function object");
             staIt++;
             continue;
         }
 
         if (txVector.GetPreambleType() == WIFI_PREAMBLE_EHT_TB &&
-            !m_apMac->GetEhtSupported(staIt->address))
+            !m_apMac->GetEhtSupported(address))
         {
             NS_LOG_DEBUG(
                 "Skipping non-EHT STA because this Trigger Frame is only soliciting EHT STAs");
@@ -1139,7 +1111,7 @@ RrMultiUserScheduler::GetTxVectorForUlMu(Func canBeSolicited, bool isbasictf)
         {
             // check that a BA agreement is established with the receiver for the
             // considered TID, since ack sequences for UL MU require block ack
-            if (m_apMac->GetBaAgreementEstablishedAsRecipient(staIt->address, tid))
+            if (m_apMac->GetBaAgreementEstablishedAsRecipient(address, tid))
             {
                 break;
             }
@@ -1147,7 +1119,7 @@ RrMultiUserScheduler::GetTxVectorForUlMu(Func canBeSolicited, bool isbasictf)
         }
         if (tid == 8)
         {
-            NS_LOG_DEBUG("No Block Ack agreement established with " << staIt->address);
+            NS_LOG_DEBUG("No Block Ack agreement established with " << address);
             staIt++;
             continue;
         }
@@ -1155,7 +1127,7 @@ RrMultiUserScheduler::GetTxVectorForUlMu(Func canBeSolicited, bool isbasictf)
         // if the first candidate STA is an EHT STA, we switch to soliciting EHT TB PPDUs
         if (txVector.GetHeMuUserInfoMap().empty())
         {
-            if (m_apMac->GetEhtSupported() && m_apMac->GetEhtSupported(staIt->address))
+            if (m_apMac->GetEhtSupported() && m_apMac->GetEhtSupported(address))
             {
                 txVector.SetPreambleType(WIFI_PREAMBLE_EHT_TB);
                 txVector.SetEhtPpduType(0);
@@ -1167,18 +1139,18 @@ RrMultiUserScheduler::GetTxVectorForUlMu(Func canBeSolicited, bool isbasictf)
         // just for the purpose of retrieving the TXVECTOR used to transmit to that station
         WifiMacHeader hdr(WIFI_MAC_QOSDATA);
         hdr.SetAddr1(GetWifiRemoteStationManager(m_linkId)
-                         ->GetAffiliatedStaAddress(staIt->address)
-                         .value_or(staIt->address));
+                         ->GetAffiliatedStaAddress(address)
+                         .value_or(address));
         hdr.SetAddr2(m_apMac->GetFrameExchangeManager(m_linkId)->GetAddress());
         WifiTxVector suTxVector =
             GetWifiRemoteStationManager(m_linkId)->GetDataTxVector(hdr, m_apMac->GetWifiPhy()->GetChannelWidth());
-        txVector.SetHeMuUserInfo(staIt->aid,
+        txVector.SetHeMuUserInfo(aid,
                                  {HeRu::RuSpec(), // assigned later by FinalizeTxVector
                                   suTxVector.GetMode().GetMcsValue(),
                                   suTxVector.GetNss()});
 
 
-         m_candidates.emplace_back(staIt, nullptr);
+         m_candidates.emplace_back(aid, nullptr);
 
         // move to the next station in the list
         staIt++;
@@ -1187,10 +1159,8 @@ RrMultiUserScheduler::GetTxVectorForUlMu(Func canBeSolicited, bool isbasictf)
     if (txVector.GetHeMuUserInfoMap().empty())
     {
         NS_LOG_DEBUG("No suitable station");
-        // std::cout << "No suitable station"<<"\n";
         return txVector;
     }
-    // std::cout << "finaltx called for UL"<<"\n";
     FinalizeTxVector(txVector, m_ulschedulerLogic, true, false);
     return txVector;
 
@@ -1200,7 +1170,6 @@ RrMultiUserScheduler::GetTxVectorForUlMu(Func canBeSolicited, bool isbasictf)
 MultiUserScheduler::TxFormat
 RrMultiUserScheduler::TrySendingBsrpTf()
 {
-    // std::cout << "At time "<< Simulator::Now()<<" TrySendingBsrpTf called"<<"\n";
     NS_LOG_FUNCTION(this);
     
     if (m_staListUl.empty())
@@ -1210,12 +1179,9 @@ RrMultiUserScheduler::TrySendingBsrpTf()
     }
 
     // only consider stations that have setup the current link
-    // std::cout << "GetTxVectorForUlMu called from TrySendingBsrpTf"<<"\n";
-    WifiTxVector txVector = GetTxVectorForUlMu([this](const MasterInfo& info) {
+    WifiTxVector txVector = GetTxVectorForUlMu([this](uint16_t aid) {
         const auto& staList = m_apMac->GetStaList(m_linkId);
-        // std::cout << "bsrp mlinkID: "<< unsigned(m_linkId)<<"\n";
-        // std::cout << "bsrp size of stalist: "<<"\n";
-        return staList.find(info.aid) != staList.cend();
+        return staList.find(aid) != staList.cend();
     }, false);
 
     if (txVector.GetHeMuUserInfoMap().empty())
@@ -1288,13 +1254,6 @@ RrMultiUserScheduler::TrySendingBsrpTf()
 MultiUserScheduler::TxFormat
 RrMultiUserScheduler::TrySendingBasicTf()
 {
-    // std::cout << "At time "<< Simulator::Now()<<" TrySendingBasicTf called"<<"\n";
-    // basic_time = Simulator::Now();
-    // std::cout << "Duration of BSRP exchange: "<<basic_time - bsrp_time<<"\n";
-    // if(basic_time - bsrp_time > TimeStep(0)){
-    //     total_bsrp_time += basic_time - bsrp_time;
-    //     // std::cout << "Total BSRP time: "<< total_bsrp_time << "\n";
-    // }
     NS_LOG_FUNCTION(this);
 
     if (m_staListUl.empty())
@@ -1308,35 +1267,35 @@ RrMultiUserScheduler::TrySendingBasicTf()
 
     // only consider stations that have setup the current link and do not have
     // reported a null queue size
-    // std::cout << "GetTxVectorForUlMu called from TrySendingBasicTf"<<"\n";
-    WifiTxVector txVector = GetTxVectorForUlMu([this](const MasterInfo& info) {
+    WifiTxVector txVector = GetTxVectorForUlMu([this](uint16_t aid) {
         const auto& staList = m_apMac->GetStaList(m_linkId);
-        // std::cout << "basic mlinkID: "<< unsigned(m_linkId)<<"\n";
-        // std::cout << "basic size of stalist: "<<staList.size()<<"\n";
-        // std::cout << "max buffer status of: "<<info.address <<" is "<<unsigned(m_apMac->GetMaxBufferStatus(info.address))<<"\n";
-        if(m_enableBsrp) return staList.find(info.aid) != staList.cend() && m_apMac->GetMaxBufferStatus(info.address) > 0;
-        return staList.find(info.aid) != staList.cend();
+        if(m_enableBsrp) return staList.find(aid) != staList.cend() && m_apMac->GetMaxBufferStatus(m_staTable[aid].address) > 0;
+        return staList.find(aid) != staList.cend();
     }, true); // when BSRP is off all stations will go through as they have 255 queue
 
     if (txVector.GetHeMuUserInfoMap().empty())
     {
         NS_LOG_DEBUG("No suitable station found");
+        // no station reported buffered bytes
+        NotifyBacklog(true, 0);
         return TxFormat::DL_MU_TX;
     }
 
     uint32_t maxBufferSize = 0;
+    double ulBacklog = 0; // bytes buffered by the solicited stations
 
     for (const auto& candidate : txVector.GetHeMuUserInfoMap())
     {
         auto address = m_apMac->GetMldOrLinkAddressByAid(candidate.first);
         NS_ASSERT_MSG(address, "AID " << candidate.first << " not found");
         uint8_t queueSize = m_apMac->GetMaxBufferStatus(*address);
-        // std::cout << "Buffer status of station " << *address << " is " << +queueSize <<"\n";
+        NS_LOG_DEBUG("Buffer status of station " << *address << " is " << +queueSize);
 
         if (queueSize == 255)
         {
             NS_LOG_DEBUG("Buffer status of station " << *address << " is unknown");
             maxBufferSize = std::max(maxBufferSize, m_ulPsduSize);
+            ulBacklog += m_ulPsduSize;
         }
         else if (queueSize == 254)
         {
@@ -1350,12 +1309,13 @@ RrMultiUserScheduler::TrySendingBasicTf()
         
             
             maxBufferSize = std::max(maxBufferSize, static_cast<uint32_t>(queueSize * 256));
+            ulBacklog += queueSize * 256;
         }
     }
 
+    NotifyBacklog(true, ulBacklog);
     if (maxBufferSize == 0)
     {
-        // std::cout << "maxbuffersize is zero"<<"\n";
         return DL_MU_TX;
     }
 
@@ -1404,49 +1364,44 @@ RrMultiUserScheduler::TrySendingBasicTf()
         }
     }
 
-    // Compute the time taken by each station to transmit a frame of maxBufferSize size
     Time bufferTxTime = Seconds(0);
-    for (const auto& userInfo : m_trigger)
+    if (m_ulDurationPolicy == "Throughput")
     {
-        auto address = m_apMac->GetMldOrLinkAddressByAid(userInfo.GetAid12());
-        uint8_t queueSize = m_apMac->GetMaxBufferStatus(*address);
-        Time duration = Seconds(0);
-        
-        if(prop_scheduler){
-        uint32_t buffer_queue = 0;
-        if(queueSize == 255){
-            buffer_queue = m_ulPsduSize;
-        }else{
-            buffer_queue = queueSize*256;
-        }
-        duration = WifiPhy::CalculateTxDuration(buffer_queue,
-                                                     txVector,
-                                                     m_apMac->GetWifiPhy(m_linkId)->GetPhyBand(),
-                                                     userInfo.GetAid12());
-        }else{
-        // uint32_t buffer_queue = 0;
-        // if(queueSize == 255){
-        //     buffer_queue = m_ulPsduSize;
-        // }else{
-        //     buffer_queue = queueSize*256;
-        // }
-        duration = WifiPhy::CalculateTxDuration(maxBufferSize,
-                                                     txVector,
-                                                     m_apMac->GetWifiPhy(m_linkId)->GetPhyBand(),
-                                                     userInfo.GetAid12()); 
-        // Time maxbufduration = WifiPhy::CalculateTxDuration(maxBufferSize,
-        //                                              txVector,
-        //                                              m_apMac->GetWifiPhy(m_linkId)->GetPhyBand(),
-        //                                              userInfo.GetAid12());
-        // std::cout << "maxbuffduration: "<< maxbufduration << "\n"; 
+        // TXOP time spent for the UL MU exchange besides the TB PPDU
+        Time overhead = m_txParams.m_txDuration + m_apMac->GetWifiPhy(m_linkId)->GetSifs();
+        if (m_txParams.m_protection && m_txParams.m_protection->protectionTime != Time::Min())
+        {
+            overhead += m_txParams.m_protection->protectionTime;
+        }
+        if (m_txParams.m_acknowledgment &&
+            m_txParams.m_acknowledgment->acknowledgmentTime != Time::Min())
+        {
+            overhead += m_txParams.m_acknowledgment->acknowledgmentTime;
+        }
+
+        bufferTxTime = PlanUlDuration(txVector, maxDuration, overhead);
+
+        // RUs may have been shrunk
+        for (auto& userInfo : m_trigger)
+        {
+            userInfo.SetRuAllocation(txVector.GetRu(userInfo.GetAid12()));
+        }
+    }
+    else
+    {
+        // Compute the time taken by each station to transmit a frame of maxBufferSize size
+        for (const auto& userInfo : m_trigger)
+        {
+            Time duration =
+                WifiPhy::CalculateTxDuration(maxBufferSize,
+                                             txVector,
+                                             m_apMac->GetWifiPhy(m_linkId)->GetPhyBand(),
+                                             userInfo.GetAid12());
+            RR_MU_TRACE(TRACE_UL_STA_DURATION, userInfo.GetAid12(), 0, duration.GetNanoSeconds());
+            bufferTxTime = Max(bufferTxTime, duration);
         }
-        
-        std::cout << "For station with AID: " << userInfo.GetAid12() <<" needs duration: "<< duration << "\n";
-        bufferTxTime = Max(bufferTxTime, duration);
-        std::cout << "buffertxtime: "<< bufferTxTime << "\n";
     }
-    
-    
+
 
         
     if (bufferTxTime < maxDuration)
@@ -1479,8 +1434,8 @@ RrMultiUserScheduler::TrySendingBasicTf()
         }
     }
 
-    ul_time = ul_time + maxDuration;
-    std::cout << "total UL time till now: "<< ul_time << "\n";
+    m_metrics.ulTime += maxDuration;
+    NS_LOG_DEBUG("Total UL time granted: " << m_metrics.ulTime);
     // maxDuration is the time to grant to the stations. Finalize the Trigger Frame
     uint16_t ulLength;
     std::tie(ulLength, maxDuration) =
@@ -1489,27 +1444,128 @@ RrMultiUserScheduler::TrySendingBasicTf()
                                                    m_apMac->GetWifiPhy(m_linkId)->GetPhyBand());
     NS_LOG_DEBUG("TB PPDU duration: " << maxDuration.As(Time::MS));
     m_trigger.SetUlLength(ulLength);
-    std::cout << "UlLength: "<< ulLength << "\n";
+    RR_MU_TRACE(TRACE_BASIC_TF, 0, ulLength, maxDuration.GetNanoSeconds());
     // set Preferred AC to the AC that gained channel access
-    std::cout << "ap_edca_AC: "<<unsigned(m_edca->GetAccessCategory())<<"\n";
-    // AcIndex dummy = AC_BE;
     for (auto& userInfo : m_trigger)
     {
         userInfo.SetBasicTriggerDepUserInfo(0, 0, m_edca->GetAccessCategory());
-        // userInfo.SetBasicTriggerDepUserInfo(0, 0, dummy);
     }
 
-    UpdateCredits(m_staListUl, maxDuration, txVector);
+    UpdateCredits(m_staListUl, UL_CREDITS, maxDuration, txVector);
+    if (m_ulschedulerLogic == "PropFair")
+    {
+        // stations are expected to send the buffered bytes, up to the amount of bytes
+        // that fit the TB PPDU on the assigned RU
+        for (const auto& [aid, userInfo] : txVector.GetHeMuUserInfoMap())
+        {
+            uint8_t queueSize = m_apMac->GetMaxBufferStatus(m_staTable[aid].address);
+            double bits = txVector.GetMode(aid).GetDataRate(txVector, aid) *
+                          maxDuration.GetSeconds();
+            if (queueSize < 254)
+            {
+                bits = std::min(bits, queueSize * 256 * 8.0);
+            }
+            else if (queueSize == 255)
+            {
+                bits = std::min(bits, m_ulPsduSize * 8.0);
+            }
+            UpdateAvgThroughput(aid, true, bits);
+        }
+    }
+    NotifyMuTx(true, maxDuration);
 
     return UL_MU_TX;
 }
 
+Time
+RrMultiUserScheduler::PlanUlDuration(WifiTxVector& txVector, Time maxDuration, Time overhead)
+{
+    NS_LOG_FUNCTION(this << maxDuration << overhead);
+
+    const auto band = m_apMac->GetWifiPhy(m_linkId)->GetPhyBand();
+    const Time preamble = WifiPhy::CalculatePhyPreambleAndHeaderDuration(txVector);
+
+    // bytes buffered by each solicited station, the time to transmit them and the
+    // rate (bytes per second) of the station on the assigned RU
+    m_ulPlan.clear();
+    for (const auto& [aid, userInfo] : txVector.GetHeMuUserInfoMap())
+    {
+        auto address = m_apMac->GetMldOrLinkAddressByAid(aid);
+        NS_ASSERT_MSG(address, "AID " << aid << " not found");
+        uint8_t queueSize = m_apMac->GetMaxBufferStatus(*address);
+
+        UlStaPlan plan;
+        plan.aid = aid;
+        plan.bytes = (queueSize == 255   ? m_ulPsduSize
+                      : queueSize == 254 ? 0xffffffff
+                                         : static_cast<uint32_t>(queueSize * 256));
+        plan.duration = WifiPhy::CalculateTxDuration(plan.bytes, txVector, band, aid);
+        plan.rate = txVector.GetMode(aid).GetDataRate(txVector, aid) / 8.0;
+        m_ulPlan.push_back(plan);
+    }
+
+    // Candidate durations are those needed by each station to transmit all its
+    // buffered bytes (capped to the max duration). Select the one that maximizes
+    // the bytes delivered per unit of TXOP time.
+    Time bestDuration = Seconds(0);
+    double bestEfficiency = -1;
+    for (const auto& candidate : m_ulPlan)
+    {
+        const Time duration = Min(candidate.duration, maxDuration);
+        const double payloadTime = std::max((duration - preamble).GetSeconds(), 0.0);
+        double bytes = 0;
+        for (const auto& plan : m_ulPlan)
+        {
+            bytes += std::min<double>(plan.bytes, payloadTime * plan.rate);
+        }
+        const double efficiency = bytes / (duration + overhead).GetMicroSeconds();
+        if (efficiency > bestEfficiency ||
+            (efficiency == bestEfficiency && duration < bestDuration))
+        {
+            bestEfficiency = efficiency;
+            bestDuration = duration;
+        }
+    }
+    NS_LOG_DEBUG("TB PPDU duration " << bestDuration.As(Time::US) << " delivers "
+                                     << bestEfficiency << " bytes/us");
+
+    // Stations that would pad are assigned the smallest RU (within the assigned RU)
+    // that still allows them to transmit all their buffered bytes
+    const auto width = txVector.GetChannelWidth();
+    for (const auto& plan : m_ulPlan)
+    {
+        if (plan.duration >= bestDuration)
+        {
+            continue;
+        }
+        auto userInfo = txVector.GetHeMuUserInfo(plan.aid);
+        const auto ru = userInfo.ru;
+        for (int t = ru.GetRuType() - 1; t >= HeRu::RU_26_TONE; t--)
+        {
+            auto smallerRu = HeRu::FindOverlappingRu(width, ru, static_cast<HeRu::RuType>(t));
+            txVector.SetHeMuUserInfo(plan.aid, {smallerRu, userInfo.mcs, userInfo.nss});
+            if (WifiPhy::CalculateTxDuration(plan.bytes, txVector, band, plan.aid) > bestDuration)
+            {
+                txVector.SetHeMuUserInfo(plan.aid, userInfo);
+                break;
+            }
+            userInfo.ru = smallerRu;
+        }
+        if (userInfo.ru != ru)
+        {
+            NS_LOG_DEBUG("RU of station with AID " << plan.aid << " shrunk from " << ru
+                                                    << " to " << userInfo.ru);
+        }
+    }
+
+    return bestDuration;
+}
+
 void
 RrMultiUserScheduler::NotifyStationAssociated(uint16_t aid, Mac48Address address)
 {
-    std::cout << "At time "<< Simulator::Now()<<" NotifyStationAssociated called"<<"\n";
-   
     NS_LOG_FUNCTION(this << aid << address);
+    RR_MU_TRACE(TRACE_STA_ASSOCIATED, aid);
 
     if (!m_apMac->GetHeSupported(address))
     {
@@ -1519,61 +1575,318 @@ RrMultiUserScheduler::NotifyStationAssociated(uint16_t aid, Mac48Address address
     auto mldOrLinkAddress = m_apMac->GetMldOrLinkAddressByAid(aid);
     NS_ASSERT_MSG(mldOrLinkAddress, "AID " << aid << " not found");
 
-    for (auto& staList : m_staListDl)
+    if (aid >= m_staTable.size())
     {
-        // if this is not the first STA of a non-AP MLD to be notified, an entry
-        // for this non-AP MLD already exists
-        const auto staIt = std::find_if(staList.second.cbegin(),
-                                        staList.second.cend(),
-                                        [aid](auto&& info) { return info.aid == aid; });
-        if (staIt == staList.second.cend())
+        m_staTable.resize(aid + 1);
+    }
+    auto& entry = m_staTable[aid];
+    // if this is not the first STA of a non-AP MLD to be notified, an entry
+    // for this non-AP MLD already exists
+    if (!entry.listed)
+    {
+        entry.address = *mldOrLinkAddress;
+        entry.listed = true;
+        // the credits of the station start from zero
+        for (std::size_t column = 0; column < N_CREDIT_COLUMNS; column++)
+        {
+            entry.credits[column] = -m_creditOffset[column];
+        }
+        entry.avgTput.fill(0);
+        entry.avgTputTime.fill(Simulator::Now());
+        m_dlPlan.ppdusLeft = 0;
+        for (auto& staList : m_staListDl)
         {
-            staList.second.push_back(MasterInfo{aid, *mldOrLinkAddress, 0.0});
+            staList.push_back(aid);
         }
+        m_staListUl.push_back(aid);
     }
 
-    const auto staIt = std::find_if(m_staListUl.cbegin(), m_staListUl.cend(), [aid](auto&& info) {
-        return info.aid == aid;
-    });
-    if (staIt == m_staListUl.cend())
+    if (aid >= m_dlStaInfo.size())
     {
-        m_staListUl.push_back(MasterInfo{aid, *mldOrLinkAddress, 0.0});
+        m_dlStaInfo.resize(aid + 1);
     }
 }
 
 void
 RrMultiUserScheduler::NotifyStationDeassociated(uint16_t aid, Mac48Address address)
 {
-    std::cout << "At time "<< Simulator::Now()<<" NotifyStationDeassociated called"<<"\n";
-   
-    NS_LOG_FUNCTION(this << aid << address);
+    NS_LOG_FUNCTION(this << aid << address);
+    RR_MU_TRACE(TRACE_STA_DEASSOCIATED, aid);
+
+    if (!m_apMac->GetHeSupported(address))
+    {
+        return;
+    }
+
+    auto mldOrLinkAddress = m_apMac->GetMldOrLinkAddressByAid(aid);
+    NS_ASSERT_MSG(mldOrLinkAddress, "AID " << aid << " not found");
+
+    if (m_apMac->IsAssociated(*mldOrLinkAddress))
+    {
+        // Another STA of the non-AP MLD is still associated
+        return;
+    }
+
+    if (aid >= m_staTable.size() || !m_staTable[aid].listed)
+    {
+        return;
+    }
+    m_staTable[aid].listed = false;
+    m_dlPlan.ppdusLeft = 0;
+    for (auto& staList : m_staListDl)
+    {
+        staList.erase(std::find(staList.begin(), staList.end(), aid));
+    }
+    m_staListUl.erase(std::find(m_staListUl.begin(), m_staListUl.end(), aid));
+}
+
+bool
+RrMultiUserScheduler::PeekDlFrame(uint16_t aid, uint8_t tid)
+{
+    const auto& address = m_staTable[aid].address;
+    auto& info = m_dlStaInfo[aid];
+    AcIndex ac = QosUtilsMapTidToAc(tid);
+    Ptr<QosTxop> txop = m_apMac->GetQosTxop(ac);
+
+    // we only check if the first frame of the given TID meets the size
+    // and duration constraints. We do not explore the queues further.
+    info.mpdu = txop->PeekNextMpdu(m_linkId, tid, address);
+    if (!info.mpdu)
+    {
+        return false;
+    }
+    info.tid = tid;
+    info.queueSize = txop->GetQosQueueSize(tid, address);
+    if (m_dlschedulerLogic == "Edf")
+    {
+        info.deadline = info.mpdu->GetTimestamp() + GetLatencyBudget(ac);
+    }
+    else if (m_dlschedulerLogic == "PropFair")
+    {
+        m_staTable[aid].pfMetric =
+            GetPfMetric(aid,
+                        false,
+                        GetWifiRemoteStationManager(m_linkId)->GetDataTxVector(
+                            info.mpdu->GetHeader(),
+                            m_apMac->GetWifiPhy()->GetChannelWidth()));
+    }
+    return true;
+}
+
+void
+RrMultiUserScheduler::RankDlStations(AcIndex primaryAc)
+{
+    NS_LOG_FUNCTION(this << primaryAc);
+
+    uint8_t currTid = wifiAcList.at(primaryAc).GetHighTid();
+
+    Ptr<WifiMpdu> mpdu = m_edca->PeekNextMpdu(m_linkId);
+
+    if (mpdu && mpdu->GetHeader().IsQosData())
+    {
+        currTid = mpdu->GetHeader().GetQosTid();
+    }
+
+    // determine the list of TIDs to check
+    std::vector<uint8_t> tids;
+
+    if (m_enableTxopSharing)
+    {
+        for (auto acIt = wifiAcList.find(primaryAc); acIt != wifiAcList.end(); acIt++)
+        {
+            uint8_t firstTid = (acIt->first == primaryAc ? currTid : acIt->second.GetHighTid());
+            tids.push_back(firstTid);
+            tids.push_back(acIt->second.GetOtherTid(firstTid));
+        }
+    }
+    else
+    {
+        tids.push_back(currTid);
+    }
+ 
+    // Candidate discovery: visit the TIDs of every station once to find the first TID
+    // for which the AP has a frame to send. The peeked MPDU and the queue size are
+    // cached in the per-AID DL info and stations are ranked by decreasing queue size
+    m_dlRanking.clear();
+    std::size_t position = 0;
+
+    for (auto staIt = m_staListDl[primaryAc].cbegin(); staIt != m_staListDl[primaryAc].cend();
+         staIt++, position++)
+    {
+        uint16_t aid = *staIt;
+        const auto& address = m_staTable[aid].address;
+        NS_ASSERT(aid < m_dlStaInfo.size());
+        auto& info = m_dlStaInfo[aid];
+        info = DlStaInfo();
+
+        if (m_txParams.m_txVector.GetPreambleType() == WIFI_PREAMBLE_EHT_MU &&
+            !m_apMac->GetEhtSupported(address))
+        {
+            continue;
+        }
+
+        // check if the AP has at least one frame to be sent to the current station
+        for (uint8_t tid : tids)
+        {
+            NS_ASSERT(QosUtilsMapTidToAc(tid) >= primaryAc);
+            // check that a BA agreement is established with the receiver for the
+            // considered TID, since ack sequences for DL MU PPDUs require block ack
+            if (!m_apMac->GetBaAgreementEstablishedAsOriginator(address, tid))
+            {
+                continue;
+            }
+            if (PeekDlFrame(aid, tid))
+            {
+                m_dlRanking.push_back({aid, info.queueSize, position});
+                break;
+            }
+            NS_LOG_DEBUG("No frames to send to " << address << " with TID=" << +tid);
+        }
+    }
+
+    // only the (at most) m_nStations stations having the largest queues (times the
+    // number of DL MU PPDUs of the lookahead plan) are sorted for now
+    m_dlRankingSorted = 0;
+    SortDlRanking(static_cast<std::size_t>(m_nStations) * m_lookahead);
+
+    double dlBacklog = 0;
+    for (const auto& rank : m_dlRanking)
+    {
+        dlBacklog += rank.queueSize;
+    }
+    NotifyBacklog(false, dlBacklog);
+}
+
+void
+RrMultiUserScheduler::SortDlRanking(std::size_t n)
+{
+    NS_LOG_FUNCTION(this << n);
+
+    // move the stations having the largest queues to the front of the unsorted part of
+    // the ranking (ties are broken based on the position in the list of stations, i.e.,
+    // based on credits). Only such stations need to be sorted.
+    auto byQueueSize = [](const DlQueueRank& a, const DlQueueRank& b) {
+        return a.queueSize > b.queueSize || (a.queueSize == b.queueSize && a.position < b.position);
+    };
+    // with the PropFair logic, stations are ranked by decreasing PF metric instead
+    auto byPfMetric = [this](const DlQueueRank& a, const DlQueueRank& b) {
+        const double ma = m_staTable[a.aid].pfMetric;
+        const double mb = m_staTable[b.aid].pfMetric;
+        return ma > mb || (ma == mb && a.position < b.position);
+    };
+    // with the Edf logic, stations are ranked by increasing deadline
+    auto byDeadline = [this](const DlQueueRank& a, const DlQueueRank& b) {
+        const Time& da = m_dlStaInfo[a.aid].deadline;
+        const Time& db = m_dlStaInfo[b.aid].deadline;
+        return da < db || (da == db && a.position < b.position);
+    };
+    auto first = m_dlRanking.begin() + m_dlRankingSorted;
+    auto last = m_dlRanking.begin() + std::min(n, m_dlRanking.size());
+    if (first >= last)
+    {
+        return;
+    }
+    if (m_dlschedulerLogic == "PropFair")
+    {
+        std::nth_element(first, last, m_dlRanking.end(), byPfMetric);
+        std::sort(first, last, byPfMetric);
+    }
+    else if (m_dlschedulerLogic == "Edf")
+    {
+        std::nth_element(first, last, m_dlRanking.end(), byDeadline);
+        std::sort(first, last, byDeadline);
+    }
+    else
+    {
+        std::nth_element(first, last, m_dlRanking.end(), byQueueSize);
+        std::sort(first, last, byQueueSize);
+    }
+    m_dlRankingSorted = last - m_dlRanking.begin();
+}
+
+void
+RrMultiUserScheduler::MakeDlPlan(AcIndex primaryAc,
+                                 std::size_t count,
+                                 HeRu::RuType ruType,
+                                 std::size_t nCentral26TonesRus)
+{
+    NS_LOG_FUNCTION(this << primaryAc << count << ruType << nCentral26TonesRus);
 
-    if (!m_apMac->GetHeSupported(address))
+    m_dlPlan.ppdusLeft = 0;
+    if (m_lookahead <= 1 || m_dlRanking.empty())
     {
         return;
     }
 
-    auto mldOrLinkAddress = m_apMac->GetMldOrLinkAddressByAid(aid);
-    NS_ASSERT_MSG(mldOrLinkAddress, "AID " << aid << " not found");
+    // the stations sorted by RankDlStations are split into groups of as many stations
+    // as the candidates of a DL MU PPDU (which may be less than m_nStations, e.g., if
+    // m_nStations exceeds the number of RUs in the channel), one group per DL MU PPDU.
+    // The group of the DL MU PPDU being prepared now is the first one.
+    m_dlPlan.ac = primaryAc;
+    m_dlPlan.groupSize =
+        std::min(static_cast<std::size_t>(m_nStations), count + nCentral26TonesRus);
+    m_dlPlan.stations.clear();
+    const auto nPlanned = std::min(m_dlPlan.groupSize * m_lookahead, m_dlRanking.size());
+    for (std::size_t i = 0; i < nPlanned; i++)
+    {
+        const auto aid = m_dlRanking[i].aid;
+        m_dlPlan.stations.push_back({aid, m_dlStaInfo[aid].tid, m_dlRanking[i].queueSize});
+    }
+    // the plan ends when its stations are used up, so that no station is planned twice
+    m_dlPlan.next = 0;
+    m_dlPlan.ppdusLeft = std::min<std::size_t>(m_lookahead,
+                                               (nPlanned + m_dlPlan.groupSize - 1) /
+                                                   m_dlPlan.groupSize);
+    m_dlPlan.count = count;
+    m_dlPlan.ruType = ruType;
+    m_dlPlan.nCentral26TonesRus = nCentral26TonesRus;
+    NS_LOG_DEBUG("DL plan of " << m_dlPlan.ppdusLeft << " PPDUs with " << nPlanned
+                               << " stations");
+}
 
-    if (m_apMac->IsAssociated(*mldOrLinkAddress))
+bool
+RrMultiUserScheduler::UseDlPlan(AcIndex primaryAc)
+{
+    NS_LOG_FUNCTION(this << primaryAc);
+
+    if (m_dlPlan.ppdusLeft == 0 || m_dlPlan.ac != primaryAc)
     {
-        // Another STA of the non-AP MLD is still associated
-        return;
+        return false;
     }
 
-    for (auto& staList : m_staListDl)
+    // only the stations of the next group are visited. The plan is dropped if any of
+    // them has no frame to send or its queue size changed by more than the threshold
+    m_dlRanking.clear();
+    NS_ASSERT(m_dlPlan.next < m_dlPlan.stations.size());
+    const auto last = std::min(m_dlPlan.next + m_dlPlan.groupSize, m_dlPlan.stations.size());
+    for (std::size_t i = m_dlPlan.next; i < last; i++)
     {
-        staList.second.remove_if([&aid](const MasterInfo& info) { return info.aid == aid; });
+        const auto& planned = m_dlPlan.stations[i];
+        const auto& entry = m_staTable[planned.aid];
+        auto& info = m_dlStaInfo[planned.aid];
+        info = DlStaInfo();
+
+        if (!entry.listed ||
+            !m_apMac->GetBaAgreementEstablishedAsOriginator(entry.address, planned.tid) ||
+            !PeekDlFrame(planned.aid, planned.tid) ||
+            std::abs(static_cast<double>(info.queueSize) - planned.queueSize) >
+                m_lookaheadThreshold * planned.queueSize)
+        {
+            NS_LOG_DEBUG("DL plan invalidated by station with AID " << planned.aid);
+            m_dlPlan.ppdusLeft = 0;
+            return false;
+        }
+        m_dlRanking.push_back({planned.aid, info.queueSize, i - m_dlPlan.next});
     }
-    m_staListUl.remove_if([&aid](const MasterInfo& info) { return info.aid == aid; });
+    m_dlRankingSorted = m_dlRanking.size();
+
+    NS_LOG_DEBUG("Using the DL plan (" << m_dlPlan.ppdusLeft << " PPDUs left)");
+    return true;
 }
 
 MultiUserScheduler::TxFormat
 RrMultiUserScheduler::TrySendingDlMuPpdu()
 {
-    // std::cout << "At time "<< Simulator::Now()<<" TrySendingDlMuPpdu called"<<"\n";
-   
     NS_LOG_FUNCTION(this);
 
     AcIndex primaryAc = m_edca->GetAccessCategory();
@@ -1581,6 +1894,7 @@ RrMultiUserScheduler::TrySendingDlMuPpdu()
     if (m_staListDl[primaryAc].empty())
     {
         NS_LOG_DEBUG("No HE stations associated: return SU_TX");
+        NotifyNoDlMuTx();
         return TxFormat::SU_TX;
     }
 
@@ -1591,198 +1905,48 @@ RrMultiUserScheduler::TrySendingDlMuPpdu()
 
     std::size_t count =
         std::min(static_cast<std::size_t>(m_nStations), m_staListDl[primaryAc].size());
-    // std::cout << "dlprimaryac: "<<unsigned(primaryAc) <<"\n";
-    // std::cout << "initial count: "<<count <<"\n";
     std::size_t nCentral26TonesRus=0;
-    uint8_t currTid = wifiAcList.at(primaryAc).GetHighTid();
-
-    Ptr<WifiMpdu> mpdu = m_edca->PeekNextMpdu(m_linkId);
-
-    if (mpdu && mpdu->GetHeader().IsQosData())
-    {
-        currTid = mpdu->GetHeader().GetQosTid();
-    }
+    HeRu::RuType ruType = HeRu::RU_26_TONE;
 
-    // determine the list of TIDs to check
-    std::vector<uint8_t> tids;
-
-    if (m_enableTxopSharing)
+    if (UseDlPlan(primaryAc))
     {
-        for (auto acIt = wifiAcList.find(primaryAc); acIt != wifiAcList.end(); acIt++)
-        {
-            uint8_t firstTid = (acIt->first == primaryAc ? currTid : acIt->second.GetHighTid());
-            tids.push_back(firstTid);
-            tids.push_back(acIt->second.GetOtherTid(firstTid));
-        }
+        // the stations to consider and the RUs are taken from the DL lookahead plan
+        count = m_dlPlan.count;
+        ruType = m_dlPlan.ruType;
+        nCentral26TonesRus = m_dlPlan.nCentral26TonesRus;
     }
     else
     {
-        tids.push_back(currTid);
-    }
- 
- auto staIttemp1 = m_staListDl[primaryAc].begin();
-    m_candidates.clear();
-
-    // std::vector<uint8_t> ruAllocations;
-    // auto numRuAllocs = m_txParams.m_txVector.GetChannelWidth() / 20;
-    // ruAllocations.resize(numRuAllocs);
-
+        RankDlStations(primaryAc);
 
-    ////////////dummy mcandidates to sort DL queue//////
-
-    while (staIttemp1 != m_staListDl[primaryAc].end()
-          )
-    { 
-        if (m_txParams.m_txVector.GetPreambleType() == WIFI_PREAMBLE_EHT_MU &&
-            !m_apMac->GetEhtSupported(staIttemp1->address))
+        count = std::min(count, m_dlRanking.size());
+        if (count == 0)
         {
-           // NS_LOG_DEBUG("Skipping non-EHT STA because this DL MU PPDU is sent to EHT STAs only");
-            staIttemp1++;
-            continue;
+            count = 1;
         }
- 
-        // check if the AP has at least one frame to be sent to the current station
-        for (uint8_t tid : tids)
+        const std::size_t limit = GetMaxNRus(m_apMac->GetWifiPhy()->GetChannelWidth());
+        count = std::min(count, limit);
+        if (IsRuPackingLogic(false))
         {
-            AcIndex ac = QosUtilsMapTidToAc(tid);
-            NS_ASSERT(ac >= primaryAc);
-            // check that a BA agreement is established with the receiver for the
-            // considered TID, since ack sequences for DL MU PPDUs require block ack
-            if (m_apMac->GetBaAgreementEstablishedAsOriginator(staIttemp1->address, tid))
-            {
-
-                mpdu = m_apMac->GetQosTxop(ac)->PeekNextMpdu(m_linkId, tid, staIttemp1->address);
-                int sz = m_apMac->GetQosTxop(ac)->GetQosQueueSize(tid,staIttemp1->address);
-                
-                // std::cout<<"Station with MAC address: "<<staIttemp1->address<<" has DL queue size: "<<sz<<"\n";
-                // we only check if the first frame of the current TID meets the size
-                // and duration constraints. We do not explore the queues further.
-                if (mpdu)
-                {   
-                     
-                    dlqueueinfo.emplace(*staIttemp1, sz);
-                    
-                     // the frame meets the constraints
-                        NS_LOG_DEBUG("Adding candidate STA (MAC=" << staIttemp1->address
-                                                                  << ", AID=" << staIttemp1->aid
-                                                                  << ") TID=" << +tid);
-                        // m_candidates.emplace_back(staIttemp1, mpdu);
-                        // std::cout << "Adding candidate STA (MAC=" << staIttemp1->address
-                        //                                           << ", AID=" << staIttemp1->aid
-                        //                                           << ") TID=" << +tid<<"\n";
-                        break; // terminate the for loop
-                    
-                }
-                else
-                {
-                    NS_LOG_DEBUG("No frames to send to " << staIttemp1->address << " with TID=" << +tid);
-                }
-            }
+            // RUs are packed by FinalizeTxVector based on the tone demand of the candidate
+            // stations, hence the time constraints are checked against the smallest RU
+            nCentral26TonesRus = 0;
         }
-
-        // move to the next station in the list
-        staIttemp1++;
-    }
-
-
-////////////////////////////
-
-m_staListDl[primaryAc].sort([this](const MasterInfo& a, const MasterInfo& b) { 
-auto mp = this->dlqueueinfo;
-int qa = this->dlqueueinfo.find(a)!=this->dlqueueinfo.end()? mp[a]:0;
-int qb = this->dlqueueinfo.find(b)!=this->dlqueueinfo.end()? mp[b]:0;
-        return (qa>qb); });
-
-
-
- auto staIttemp = m_staListDl[primaryAc].begin();
-    m_candidates.clear();
-
-    while (staIttemp != m_staListDl[primaryAc].end() &&
-           m_candidates.size() <
-               std::min(static_cast<std::size_t>(m_nStations), count + nCentral26TonesRus))
-    {
-        NS_LOG_DEBUG("Next candidate STA (MAC=" << staIttemp->address << ", AID=" << staIttemp->aid << ")");
-
-        if (m_txParams.m_txVector.GetPreambleType() == WIFI_PREAMBLE_EHT_MU &&
-            !m_apMac->GetEhtSupported(staIttemp->address))
+        else
         {
-            NS_LOG_DEBUG("Skipping non-EHT STA because this DL MU PPDU is sent to EHT STAs only");
-            staIttemp++;
-            continue;
+            ruType = HeRu::GetEqualSizedRusForStations(m_apMac->GetWifiPhy()->GetChannelWidth(),
+                                                       count,
+                                                       nCentral26TonesRus,
+                                                       scheduler_x);
         }
- 
-        // check if the AP has at least one frame to be sent to the current station
-        for (uint8_t tid : tids)
+        if (!m_useCentral26TonesRus)
         {
-            AcIndex ac = QosUtilsMapTidToAc(tid);
-            NS_ASSERT(ac >= primaryAc);
-            // check that a BA agreement is established with the receiver for the
-            // considered TID, since ack sequences for DL MU PPDUs require block ack
-            if (m_apMac->GetBaAgreementEstablishedAsOriginator(staIttemp->address, tid))
-            {
-
-                mpdu = m_apMac->GetQosTxop(ac)->PeekNextMpdu(m_linkId, tid, staIttemp->address);
-                // int sz = m_apMac->GetQosTxop(ac)->GetQosQueueSize(tid,staIttemp->address);
-                // std::cout<<"Station with MAC address: "<<staIttemp->address<<" has DL queue size: "<<sz<<"\n";
-                // we only check if the first frame of the current TID meets the size
-                // and duration constraints. We do not explore the queues further.
-                if (mpdu)
-                {
-                    
-                     // the frame meets the constraints
-                        NS_LOG_DEBUG("Adding candidate STA (MAC=" << staIttemp->address
-                                                                  << ", AID=" << staIttemp->aid
-                                                                  << ") TID=" << +tid);
-                        m_candidates.emplace_back(staIttemp, mpdu);
-                        // std::cout << "Adding candidate STA (MAC=" << staIttemp->address
-                        //                                           << ", AID=" << staIttemp->aid
-                        //                                           << ") TID=" << +tid<<"\n";
-                        break; // terminate the for loop
-                    
-                }
-                else
-                {
-                    NS_LOG_DEBUG("No frames to send to " << staIttemp->address << " with TID=" << +tid);
-                }
-            }
+            nCentral26TonesRus = 0;
         }
-
-        // move to the next station in the list
-        staIttemp++;
-    }
-
-
-
-count = std::min (static_cast<std::size_t> (m_nStations), m_candidates.size ());
-if(count==0)count=1;
-//   std::cout<<count<<" Printing count \n";
-  std::size_t limit = 9;
-  if(m_apMac->GetWifiPhy()->GetChannelWidth() == 20){
-        limit = 9;
-    }else if(m_apMac->GetWifiPhy()->GetChannelWidth() == 40){
-        limit = 18;
-    }else if(m_apMac->GetWifiPhy()->GetChannelWidth() == 80){
-        limit = 37;
-    }else if(m_apMac->GetWifiPhy()->GetChannelWidth() == 160){
-        limit = 74;
+        MakeDlPlan(primaryAc, count, ruType, nCentral26TonesRus);
     }
-
-  count = std::min(count, limit);
-    std::cout << "width: "<<m_allowedWidth <<"\n";
-    std::cout << "width in apmac: "<< m_apMac->GetWifiPhy()->GetChannelWidth() << "\n";
-    HeRu::RuType ruType =
-        HeRu::GetEqualSizedRusForStations(m_apMac->GetWifiPhy()->GetChannelWidth(), count, nCentral26TonesRus, scheduler_x);
     NS_ASSERT(count >= 1);
 
-    // std::cout << "DL count after allocation: "<<count <<"\n";
-
-    if (!m_useCentral26TonesRus)
-    {
-        nCentral26TonesRus = 0;
-    }
-
-
 
     Ptr<HeConfiguration> heConfiguration = m_apMac->GetHeConfiguration();
     NS_ASSERT(heConfiguration);
@@ -1799,8 +1963,8 @@ if(count==0)count=1;
     // For the moment, we are considering just one MPDU per receiver.
     Time actualAvailableTime = (m_initialFrame ? Time::Min() : m_availableTime);
 
-    // iterate over the associated stations until an enough number of stations is identified
-    auto staIt = m_staListDl[primaryAc].begin();
+    // iterate over the ranked stations until an enough number of stations is identified
+    auto rankIt = m_dlRanking.cbegin();
     m_candidates.clear();
 
     std::vector<uint8_t> ruAllocations;
@@ -1808,89 +1972,79 @@ if(count==0)count=1;
     ruAllocations.resize(numRuAllocs);
     NS_ASSERT((m_candidates.size() % numRuAllocs) == 0);
 
-    while (staIt != m_staListDl[primaryAc].end() &&
+    while (rankIt != m_dlRanking.cend() &&
            m_candidates.size() <
                std::min(static_cast<std::size_t>(m_nStations), count + nCentral26TonesRus))
     {
-        NS_LOG_DEBUG("Next candidate STA (MAC=" << staIt->address << ", AID=" << staIt->aid << ")");
+        const auto rank = static_cast<std::size_t>(rankIt - m_dlRanking.cbegin());
+        if (rank == m_dlRankingSorted)
+        {
+            // the best ranked stations do not meet the constraints, sort the next ones
+            SortDlRanking(m_dlRankingSorted + m_nStations);
+        }
+        if (m_dlPlan.ppdusLeft > 0 && rank == m_dlPlan.groupSize)
+        {
+            // the stations of the first group do not fill the DL MU PPDU. The stations
+            // of the next groups may be added to this DL MU PPDU, hence the plan is dropped
+            NS_LOG_DEBUG("DL plan dropped because the first group does not fill the PPDU");
+            m_dlPlan.ppdusLeft = 0;
+        }
+        uint16_t aid = (rankIt++)->aid;
+        const auto& address = m_staTable[aid].address;
+        NS_LOG_DEBUG("Next candidate STA (MAC=" << address << ", AID=" << aid << ")");
 
         if (m_txParams.m_txVector.GetPreambleType() == WIFI_PREAMBLE_EHT_MU &&
-            !m_apMac->GetEhtSupported(staIt->address))
+            !m_apMac->GetEhtSupported(address))
         {
             NS_LOG_DEBUG("Skipping non-EHT STA because this DL MU PPDU is sent to EHT STAs only");
-            staIt++;
             continue;
         }
 
         HeRu::RuType currRuType = (m_candidates.size() < count ? ruType : HeRu::RU_26_TONE);
 
-        // check if the AP has at least one frame to be sent to the current station
-        for (uint8_t tid : tids)
-        {
-            AcIndex ac = QosUtilsMapTidToAc(tid);
-            NS_ASSERT(ac >= primaryAc);
-            // check that a BA agreement is established with the receiver for the
-            // considered TID, since ack sequences for DL MU PPDUs require block ack
-            if (m_apMac->GetBaAgreementEstablishedAsOriginator(staIt->address, tid))
-            {
-                mpdu = m_apMac->GetQosTxop(ac)->PeekNextMpdu(m_linkId, tid, staIt->address);
+        auto& info = m_dlStaInfo[aid];
+        NS_ASSERT(info.mpdu);
+        info.mpdu = GetHeFem(m_linkId)->CreateAliasIfNeeded(info.mpdu);
+        // Use a temporary TX vector including only the STA-ID of the
+        // candidate station to check if the MPDU meets the size and time limits.
+        // An RU of the computed size is tentatively assigned to the candidate
+        // station, so that the TX duration can be correctly computed.
+        WifiTxVector suTxVector =
+            GetWifiRemoteStationManager(m_linkId)->GetDataTxVector(info.mpdu->GetHeader(),
+                                                                   m_apMac->GetWifiPhy()->GetChannelWidth());
+        info.mcs = suTxVector.GetMode().GetMcsValue();
+        info.nss = suTxVector.GetNss();
 
-                // we only check if the first frame of the current TID meets the size
-                // and duration constraints. We do not explore the queues further.
-                if (mpdu)
-                {
-                    mpdu = GetHeFem(m_linkId)->CreateAliasIfNeeded(mpdu);
-                    // Use a temporary TX vector including only the STA-ID of the
-                    // candidate station to check if the MPDU meets the size and time limits.
-                    // An RU of the computed size is tentatively assigned to the candidate
-                    // station, so that the TX duration can be correctly computed.
-                    WifiTxVector suTxVector =
-                        GetWifiRemoteStationManager(m_linkId)->GetDataTxVector(mpdu->GetHeader(),
-                                                                               m_apMac->GetWifiPhy()->GetChannelWidth());
-
-                    WifiTxVector txVectorCopy = m_txParams.m_txVector;
-
-                    // the first candidate STA determines the preamble type for the DL MU PPDU
-                    if (m_candidates.empty() &&
-                        suTxVector.GetPreambleType() == WIFI_PREAMBLE_EHT_MU)
-                    {
-                        m_txParams.m_txVector.SetPreambleType(WIFI_PREAMBLE_EHT_MU);
-                        m_txParams.m_txVector.SetEhtPpduType(0); // indicates DL OFDMA transmission
-                    }
+        WifiTxVector txVectorCopy = m_txParams.m_txVector;
 
-                    m_txParams.m_txVector.SetHeMuUserInfo(staIt->aid,
-                                                          {{currRuType, 1, true},
-                                                           suTxVector.GetMode().GetMcsValue(),
-                                                           suTxVector.GetNss()});
+        // the first candidate STA determines the preamble type for the DL MU PPDU
+        if (m_candidates.empty() && suTxVector.GetPreambleType() == WIFI_PREAMBLE_EHT_MU)
+        {
+            m_txParams.m_txVector.SetPreambleType(WIFI_PREAMBLE_EHT_MU);
+            m_txParams.m_txVector.SetEhtPpduType(0); // indicates DL OFDMA transmission
+        }
 
-                    if (!GetHeFem(m_linkId)->TryAddMpdu(mpdu, m_txParams, actualAvailableTime))
-                    {
-                        NS_LOG_DEBUG("Adding the peeked frame violates the time constraints");
-                        m_txParams.m_txVector = txVectorCopy;
-                    }
-                    else
-                    {
-                        // the frame meets the constraints
-                        NS_LOG_DEBUG("Adding candidate STA (MAC=" << staIt->address
-                                                                  << ", AID=" << staIt->aid
-                                                                  << ") TID=" << +tid);
-                        m_candidates.emplace_back(staIt, mpdu);
-                        break; // terminate the for loop
-                    }
-                }
-                else
-                {
-                    NS_LOG_DEBUG("No frames to send to " << staIt->address << " with TID=" << +tid);
-                }
-            }
+        m_txParams.m_txVector.SetHeMuUserInfo(aid,
+                                              {{currRuType, 1, true}, info.mcs, info.nss});
+
+        if (!GetHeFem(m_linkId)->TryAddMpdu(info.mpdu, m_txParams, actualAvailableTime))
+        {
+            NS_LOG_DEBUG("Adding the peeked frame violates the time constraints");
+            m_txParams.m_txVector = txVectorCopy;
+            continue;
         }
 
-        // move to the next station in the list
-        staIt++;
+        // the frame meets the constraints
+        NS_LOG_DEBUG("Adding candidate STA (MAC=" << address << ", AID=" << aid
+                                                  << ") TID=" << +info.tid);
+        m_candidates.emplace_back(aid, info.mpdu);
     }
 
     if (m_candidates.empty())
     {
+        // the plan is dropped, so that the stations are ranked again at the next attempt
+        m_dlPlan.ppdusLeft = 0;
+        NotifyNoDlMuTx();
         if (m_forceDlOfdma)
         {
             NS_LOG_DEBUG("The AP does not have suitable frames to transmit: return NO_TX");
@@ -1900,16 +2054,78 @@ if(count==0)count=1;
         return SU_TX;
     }
 
+    // the group of the plan is used up only now that a DL MU PPDU is built
+    if (m_dlPlan.ppdusLeft > 0)
+    {
+        m_dlPlan.next += m_dlPlan.groupSize;
+        m_dlPlan.ppdusLeft--;
+    }
+
     return TxFormat::DL_MU_TX;
 }
 
+bool
+RrMultiUserScheduler::IsRuPackingLogic(bool ul) const
+{
+    const auto& logic = (ul ? m_ulschedulerLogic : m_dlschedulerLogic);
+    // the Edf logic is only defined for DL
+    return logic == "Mixed" || logic == "PropFair" || (!ul && logic == "Edf");
+}
+
+void
+RrMultiUserScheduler::AssignPackedRus(WifiTxVector& txVector, bool ul)
+{
+    NS_LOG_FUNCTION(this << ul);
+
+    if ((ul ? m_ulschedulerLogic : m_dlschedulerLogic) == "PropFair")
+    {
+        // candidates are served in order, hence put the stations with the largest PF
+        // metrics first (only those that can be assigned an RU are sorted). DL candidates
+        // are usually sorted already, since stations are ranked by PF metric
+        auto byPfMetric = [this](const CandidateInfo& a, const CandidateInfo& b) {
+            return m_staTable[a.first].pfMetric > m_staTable[b.first].pfMetric;
+        };
+        if (!std::is_sorted(m_candidates.begin(), m_candidates.end(), byPfMetric))
+        {
+            auto last = m_candidates.begin() + std::min(MAX_RUS, m_candidates.size());
+            std::nth_element(m_candidates.begin(), last, m_candidates.end(), byPfMetric);
+            std::sort(m_candidates.begin(), last, byPfMetric);
+        }
+    }
+
+    // re-allocate RUs based on the actual number of candidate stations
+    WifiTxVector::HeMuUserInfoMap heMuUserInfoMap;
+    std::swap(heMuUserInfoMap, txVector.GetHeMuUserInfoMap());
+
+    PropAllocation ruAllocation;
+    prop_scheduler_fun(m_candidates, m_apMac->GetWifiPhy()->GetChannelWidth(), ul, ruAllocation);
+
+    std::size_t i = 0;
+    for (auto candidateIt = m_candidates.begin(); candidateIt != m_candidates.end(); i++)
+    {
+        if (i >= MAX_RUS || !ruAllocation[i])
+        {
+            // remove candidates that will not be served
+            candidateIt = m_candidates.erase(candidateIt);
+            continue;
+        }
+        auto mapIt = heMuUserInfoMap.find(candidateIt->first);
+        NS_ASSERT(mapIt != heMuUserInfoMap.end());
+
+        txVector.SetHeMuUserInfo(mapIt->first,
+                                 {*ruAllocation[i], mapIt->second.mcs, mapIt->second.nss});
+        candidateIt++;
+    }
+    // PackRus only uses RUs that the RU_ALLOCATION subfields derived by the TXVECTOR
+    // of a DL MU PPDU can signal, hence they are not set here
+}
+
 void
 RrMultiUserScheduler::FinalizeTxVector(WifiTxVector& txVector, std::string scheduler_logic, bool ul, bool basictf)
 {
 
     if(!ul){ // DL code
 
-        // std::cout << "At time "<< Simulator::Now()<<" FinalizeTxVector called for ComputeDLMUInfo"<<"\n";
         bool scheduler_x = true; // rr
         if(scheduler_logic == "Bellalta") scheduler_x = false;
         else scheduler_x = true;
@@ -1922,60 +2138,19 @@ RrMultiUserScheduler::FinalizeTxVector(WifiTxVector& txVector, std::string sched
         // compute how many stations can be granted an RU and the RU size
         std::size_t nRusAssigned = m_candidates.size();
         std::size_t nCentral26TonesRus;
-        std::size_t limit = 9;
-        if(m_apMac->GetWifiPhy()->GetChannelWidth() == 20){
-        limit = 9;
-    }else if(m_apMac->GetWifiPhy()->GetChannelWidth() == 40){
-        limit = 18;
-    }else if(m_apMac->GetWifiPhy()->GetChannelWidth() == 80){
-        limit = 37;
-    }else if(m_apMac->GetWifiPhy()->GetChannelWidth() == 160){
-        limit = 74;
-    }
-
-    if(prop_scheduler && false){
-
-        std::cout << "width: "<<m_allowedWidth <<"\n";
-        std::cout << "width in apmac: "<< m_apMac->GetWifiPhy()->GetChannelWidth() << "\n";
-        
-        // re-allocate RUs based on the actual number of candidate stations
-        WifiTxVector::HeMuUserInfoMap heMuUserInfoMap;
-        std::swap(heMuUserInfoMap, txVector.GetHeMuUserInfoMap());
-
-        auto candidateIt = m_candidates.begin(); // iterator over the list of candidate receivers
-        std::cout << "prop dl"<<"\n";
-        std::vector<HeRu::RuSpec> RU_array;
-        RU_array = prop_scheduler_fun(m_candidates, m_apMac->GetWifiPhy()->GetChannelWidth(), false);
-
-        for (std::size_t i = 0; i < RU_array.size(); i++)
-        {
-            NS_ASSERT(candidateIt != m_candidates.end());
-            auto mapIt = heMuUserInfoMap.find(candidateIt->first->aid);
-            NS_ASSERT(mapIt != heMuUserInfoMap.end());
-
-            txVector.SetHeMuUserInfo(mapIt->first,
-                                     {RU_array[i],
-                                      mapIt->second.mcs,
-                                      mapIt->second.nss});
-            candidateIt++;
-            if(candidateIt == m_candidates.end ()){
-                    break;
-                  }
-        }
-
-        // remove candidates that will not be served
-        m_candidates.erase(candidateIt, m_candidates.end());
+        const std::size_t limit = GetMaxNRus(m_apMac->GetWifiPhy()->GetChannelWidth());
 
+    if (IsRuPackingLogic(false))
+    {
+        AssignPackedRus(txVector, false);
     }else{
 
         nRusAssigned = std::min(nRusAssigned, limit);
-        std::cout << "width: "<<m_allowedWidth <<"\n";
-        std::cout << "width in apmac: "<< m_apMac->GetWifiPhy()->GetChannelWidth() << "\n";
         HeRu::RuType ruType =
             HeRu::GetEqualSizedRusForStations(m_apMac->GetWifiPhy()->GetChannelWidth(), nRusAssigned, nCentral26TonesRus, scheduler_x);
 
         NS_LOG_DEBUG(nRusAssigned << " stations are being assigned a " << ruType << " RU");
-        std::cout << "In DL "<< nRusAssigned << " stations are being assigned a " << ruType << " RU"<<"\n";
+        RR_MU_TRACE(TRACE_DL_RU_TYPE, 0, nRusAssigned, ruType);
         if (!m_useCentral26TonesRus || m_candidates.size() == nRusAssigned)
         {
             nCentral26TonesRus = 0;
@@ -1991,7 +2166,7 @@ RrMultiUserScheduler::FinalizeTxVector(WifiTxVector& txVector, std::string sched
         std::swap(heMuUserInfoMap, txVector.GetHeMuUserInfoMap());
 
         auto candidateIt = m_candidates.begin(); // iterator over the list of candidate receivers
-        auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), ruType, 0, false);
+        auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), ruType);
         auto ruSetIt = ruSet.begin();
         auto central26TonesRus = HeRu::GetCentral26TonesRus(m_apMac->GetWifiPhy()->GetChannelWidth(), ruType);
         auto central26TonesRusIt = central26TonesRus.begin();
@@ -1999,15 +2174,14 @@ RrMultiUserScheduler::FinalizeTxVector(WifiTxVector& txVector, std::string sched
         for (std::size_t i = 0; i < nRusAssigned + nCentral26TonesRus; i++)
         {
             NS_ASSERT(candidateIt != m_candidates.end());
-            auto mapIt = heMuUserInfoMap.find(candidateIt->first->aid);
+            auto mapIt = heMuUserInfoMap.find(candidateIt->first);
             NS_ASSERT(mapIt != heMuUserInfoMap.end());
 
-            std::cout << "DL station: " << candidateIt->first->address << "RU: "<< *ruSetIt <<"\n"; 
-
             txVector.SetHeMuUserInfo(mapIt->first,
                                      {(i < nRusAssigned ? *ruSetIt++ : *central26TonesRusIt++),
                                       mapIt->second.mcs,
                                       mapIt->second.nss});
+            RR_MU_TRACE(TRACE_DL_RU, mapIt->first, EncodeRu(txVector.GetRu(mapIt->first)));
             candidateIt++;
             if(candidateIt == m_candidates.end ()){
                     break;
@@ -2023,7 +2197,6 @@ RrMultiUserScheduler::FinalizeTxVector(WifiTxVector& txVector, std::string sched
 
         if(basictf){//Basic TF
 
-        // std::cout << "At time "<< Simulator::Now()<<" FinalizeTxVector called for Basic TF"<<"\n";
         bool scheduler_x = true; // rr
         if(scheduler_logic == "Bellalta") scheduler_x = false;
         else scheduler_x = true;
@@ -2036,55 +2209,18 @@ RrMultiUserScheduler::FinalizeTxVector(WifiTxVector& txVector, std::string sched
         // compute how many stations can be granted an RU and the RU size
         std::size_t nRusAssigned = m_candidates.size();
         std::size_t nCentral26TonesRus;
-        std::size_t limit = 9;
-        if(m_apMac->GetWifiPhy()->GetChannelWidth() == 20){
-        limit = 9;
-    }else if(m_apMac->GetWifiPhy()->GetChannelWidth() == 40){
-        limit = 18;
-    }else if(m_apMac->GetWifiPhy()->GetChannelWidth() == 80){
-        limit = 37;
-    }else if(m_apMac->GetWifiPhy()->GetChannelWidth() == 160){
-        limit = 74;
-    }
-
-    if(prop_scheduler){
-        // re-allocate RUs based on the actual number of candidate stations
-        WifiTxVector::HeMuUserInfoMap heMuUserInfoMap;
-        std::swap(heMuUserInfoMap, txVector.GetHeMuUserInfoMap());
-    
-        auto candidateIt = m_candidates.begin(); // iterator over the list of candidate receivers
-        std::cout << "prop ul"<<"\n";
-        std::vector<HeRu::RuSpec> RU_array;
-        RU_array = prop_scheduler_fun(m_candidates, m_apMac->GetWifiPhy()->GetChannelWidth(), true);
-    
-        for (std::size_t i = 0; i < RU_array.size(); i++)
-        {
-            NS_ASSERT(candidateIt != m_candidates.end());
-            auto mapIt = heMuUserInfoMap.find(candidateIt->first->aid);
-            NS_ASSERT(mapIt != heMuUserInfoMap.end());
-            txVector.SetHeMuUserInfo(mapIt->first,
-                                     {RU_array[i],
-                                      mapIt->second.mcs,
-                                      mapIt->second.nss});
-            candidateIt++;
-            if(candidateIt == m_candidates.end ()){
-                    break;
-                  }
-        }
-    
-        // remove candidates that will not be served
-        m_candidates.erase(candidateIt, m_candidates.end());
+        const std::size_t limit = GetMaxNRus(m_apMac->GetWifiPhy()->GetChannelWidth());
 
+    if (IsRuPackingLogic(true))
+    {
+        AssignPackedRus(txVector, true);
     }else{
 
         nRusAssigned = std::min(nRusAssigned, limit);
-        std::cout << "width: "<<m_allowedWidth <<"\n";
-        std::cout << "width in apmac: "<< m_apMac->GetWifiPhy()->GetChannelWidth() << "\n";
         HeRu::RuType ruType =
             HeRu::GetEqualSizedRusForStations(m_apMac->GetWifiPhy()->GetChannelWidth(), nRusAssigned, nCentral26TonesRus, scheduler_x);
     
         NS_LOG_DEBUG(nRusAssigned << " stations are being assigned a " << ruType << " RU");
-        // std::cout << "In UL Basic TF"<< nRusAssigned << " stations are being assigned a " << ruType << " RU"<<"\n";
         if (!m_useCentral26TonesRus || m_candidates.size() == nRusAssigned)
         {
             nCentral26TonesRus = 0;
@@ -2100,7 +2236,7 @@ RrMultiUserScheduler::FinalizeTxVector(WifiTxVector& txVector, std::string sched
         std::swap(heMuUserInfoMap, txVector.GetHeMuUserInfoMap());
     
         auto candidateIt = m_candidates.begin(); // iterator over the list of candidate receivers
-        auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), ruType, 0, false);
+        auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), ruType);
         auto ruSetIt = ruSet.begin();
         auto central26TonesRus = HeRu::GetCentral26TonesRus(m_apMac->GetWifiPhy()->GetChannelWidth(), ruType);
         auto central26TonesRusIt = central26TonesRus.begin();
@@ -2108,10 +2244,8 @@ RrMultiUserScheduler::FinalizeTxVector(WifiTxVector& txVector, std::string sched
         for (std::size_t i = 0; i < nRusAssigned + nCentral26TonesRus; i++)
         {
             NS_ASSERT(candidateIt != m_candidates.end());
-            auto mapIt = heMuUserInfoMap.find(candidateIt->first->aid);
+            auto mapIt = heMuUserInfoMap.find(candidateIt->first);
             NS_ASSERT(mapIt != heMuUserInfoMap.end());
-        // std::cout<<"Served station address "<<(candidateIt->first->address)<<" has buffer : "<<
-        // unsigned(m_apMac->GetMaxBufferStatus(candidateIt->first->address))<<"\n";
             txVector.SetHeMuUserInfo(mapIt->first,
                                      {(i < nRusAssigned ? *ruSetIt++ : *central26TonesRusIt++),
                                       mapIt->second.mcs,
@@ -2129,7 +2263,6 @@ RrMultiUserScheduler::FinalizeTxVector(WifiTxVector& txVector, std::string sched
 ////////////////////////////////////////////////////////////
         }else{//BSRP TF
 
-        std::cout << "At time "<< Simulator::Now()<<" FinalizeTxVector called for BSRP TF"<<"\n";
         bool scheduler_x = false; // equal aplit always so all STA will send BSR
         
         // Do not log txVector because GetTxVectorForUlMu() left RUs undefined and
@@ -2140,25 +2273,14 @@ RrMultiUserScheduler::FinalizeTxVector(WifiTxVector& txVector, std::string sched
         // compute how many stations can be granted an RU and the RU size
         std::size_t nRusAssigned = m_candidates.size();
         std::size_t nCentral26TonesRus;
-        std::size_t limit = 9;
-        if(m_apMac->GetWifiPhy()->GetChannelWidth() == 20){
-        limit = 9;
-    }else if(m_apMac->GetWifiPhy()->GetChannelWidth() == 40){
-        limit = 18;
-    }else if(m_apMac->GetWifiPhy()->GetChannelWidth() == 80){
-        limit = 37;
-    }else if(m_apMac->GetWifiPhy()->GetChannelWidth() == 160){
-        limit = 74;
-    }
+        const std::size_t limit = GetMaxNRus(m_apMac->GetWifiPhy()->GetChannelWidth());
 
         nRusAssigned = std::min(nRusAssigned, limit);
-        std::cout << "width: "<<m_allowedWidth <<"\n";
-        std::cout << "width in apmac: "<< m_apMac->GetWifiPhy()->GetChannelWidth() << "\n";
         HeRu::RuType ruType =
             HeRu::GetEqualSizedRusForStations(m_apMac->GetWifiPhy()->GetChannelWidth(), nRusAssigned, nCentral26TonesRus, scheduler_x);
     
         NS_LOG_DEBUG(nRusAssigned << " stations are being assigned a " << ruType << " RU");
-        std::cout << "In UL BSRP TF"<< nRusAssigned << " stations are being assigned a " << ruType << " RU"<<"\n";
+        RR_MU_TRACE(TRACE_BSRP_RU_TYPE, 0, nRusAssigned, ruType);
         if (!m_useCentral26TonesRus || m_candidates.size() == nRusAssigned)
         {
             nCentral26TonesRus = 0;
@@ -2174,7 +2296,7 @@ RrMultiUserScheduler::FinalizeTxVector(WifiTxVector& txVector, std::string sched
         std::swap(heMuUserInfoMap, txVector.GetHeMuUserInfoMap());
     
         auto candidateIt = m_candidates.begin(); // iterator over the list of candidate receivers
-        auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), ruType, 0, false);
+        auto ruSet = HeRu::GetRusOfType(m_apMac->GetWifiPhy()->GetChannelWidth(), ruType);
         auto ruSetIt = ruSet.begin();
         auto central26TonesRus = HeRu::GetCentral26TonesRus(m_apMac->GetWifiPhy()->GetChannelWidth(), ruType);
         auto central26TonesRusIt = central26TonesRus.begin();
@@ -2182,10 +2304,8 @@ RrMultiUserScheduler::FinalizeTxVector(WifiTxVector& txVector, std::string sched
         for (std::size_t i = 0; i < nRusAssigned + nCentral26TonesRus; i++)
         {
             NS_ASSERT(candidateIt != m_candidates.end());
-            auto mapIt = heMuUserInfoMap.find(candidateIt->first->aid);
+            auto mapIt = heMuUserInfoMap.find(candidateIt->first);
             NS_ASSERT(mapIt != heMuUserInfoMap.end());
-        // std::cout<<"Served station address "<<(candidateIt->first->address)<<" has buffer : "<<
-        // unsigned(m_apMac->GetMaxBufferStatus(candidateIt->first->address))<<"\n";
             txVector.SetHeMuUserInfo(mapIt->first,
                                      {(i < nRusAssigned ? *ruSetIt++ : *central26TonesRusIt++),
                                       mapIt->second.mcs,
@@ -2206,59 +2326,161 @@ RrMultiUserScheduler::FinalizeTxVector(WifiTxVector& txVector, std::string sched
 }
 
 void
-RrMultiUserScheduler::UpdateCredits(std::list<MasterInfo>& staList,
+RrMultiUserScheduler::UpdateCredits(std::vector<uint16_t>& staList,
+                                    std::size_t column,
                                     Time txDuration,
                                     const WifiTxVector& txVector)
 {
-
     NS_LOG_FUNCTION(this << txDuration.As(Time::US) << txVector);
-// std::cout << txDuration.As(Time::US) << "tx duration "<<txVector<<"\n";
+
     // find how many RUs have been allocated for each RU type
-    std::map<HeRu::RuType, std::size_t> ruMap;
+    std::array<std::size_t, N_RU_TYPES> nRus{};
     for (const auto& userInfo : txVector.GetHeMuUserInfoMap())
     {
-        ruMap.insert({userInfo.second.ru.GetRuType(), 0}).first->second++;
+        nRus[userInfo.second.ru.GetRuType()]++;
+    }
+    uint16_t allocatedMhz = 0;
+    for (std::size_t t = 0; t < N_RU_TYPES; t++)
+    {
+        allocatedMhz += nRus[t] * HeRu::GetBandwidth(static_cast<HeRu::RuType>(t));
     }
-
 
     // The amount of credits received by each station equals the TX duration (in
     // microseconds) divided by the number of stations.
     double creditsPerSta = txDuration.ToDouble(Time::US) / staList.size();
     // Transmitting stations have to pay a number of credits equal to the TX duration
     // (in microseconds) times the allocated bandwidth share.
-    double debitsPerMhz =
-        txDuration.ToDouble(Time::US) /
-        std::accumulate(ruMap.begin(), ruMap.end(), 0, [](uint16_t sum, auto pair) {
-            return sum + pair.second * HeRu::GetBandwidth(pair.first);
-        });
-    
-    // assign credits to all stations
-    for (auto& sta : staList)
+    double debitsPerMhz = txDuration.ToDouble(Time::US) / allocatedMhz;
+    double maxCredits = m_maxCredits.ToDouble(Time::US);
+
+    // assign credits to all stations. Credits only increase (up to the cap), hence the
+    // relative order of the stations is not affected
+    double& creditOffset = m_creditOffset[column];
+    creditOffset += creditsPerSta;
+    auto credits = [this, column, &creditOffset, maxCredits](uint16_t aid) {
+        return std::min(m_staTable[aid].credits[column] + creditOffset, maxCredits);
+    };
+    auto byCredits = [&credits](uint16_t a, uint16_t b) { return credits(a) > credits(b); };
+
+    // subtract debits to the selected stations, whose AIDs are sorted so that they can
+    // be looked up while taking them out of the list
+    NS_ASSERT(m_candidates.size() <= MAX_RUS);
+    std::array<uint16_t, MAX_RUS> candidateAids;
+    std::size_t nCandidates = 0;
+    for (auto& candidate : m_candidates)
+    {
+        auto mapIt = txVector.GetHeMuUserInfoMap().find(candidate.first);
+        NS_ASSERT(mapIt != txVector.GetHeMuUserInfoMap().end());
+
+        auto& entry = m_staTable[candidate.first];
+        entry.credits[column] = credits(candidate.first) -
+                                debitsPerMhz * HeRu::GetBandwidth(mapIt->second.ru.GetRuType()) -
+                                creditOffset;
+        candidateAids[nCandidates++] = candidate.first;
+    }
+    std::sort(candidateAids.begin(), candidateAids.begin() + nCandidates);
+
+    // move the debited stations (in the order of the list) to a scratch array and compact
+    // the other stations at the front of the list
+    std::array<uint16_t, MAX_RUS> debited;
+    std::size_t nDebited = 0;
+    std::size_t nKept = 0;
+    for (std::size_t i = 0; i < staList.size(); i++)
     {
-        sta.credits += creditsPerSta;
-        sta.credits = std::min(sta.credits, m_maxCredits.ToDouble(Time::US));
+        const auto aid = staList[i];
+        if (std::binary_search(candidateAids.begin(), candidateAids.begin() + nCandidates, aid))
+        {
+            debited[nDebited++] = aid;
+        }
+        else
+        {
+            staList[nKept++] = aid;
+        }
     }
+    NS_ASSERT(nDebited == nCandidates);
 
-    // subtract debits to the selected stations
-    for (auto& candidate : m_candidates)
+    // the remaining stations are still sorted in decreasing order of credits, unless
+    // the list was sorted based on other criteria (e.g., buffer status for UL)
+    if (!std::is_sorted(staList.begin(), staList.begin() + nKept, byCredits))
     {
-        auto mapIt = txVector.GetHeMuUserInfoMap().find(candidate.first->aid);
-        NS_ASSERT(mapIt != txVector.GetHeMuUserInfoMap().end());
+        std::stable_sort(staList.begin(), staList.begin() + nKept, byCredits);
+    }
+    // sort the (few) debited stations by insertion, which keeps the order of the list
+    // for stations having the same credits
+    for (std::size_t i = 1; i < nDebited; i++)
+    {
+        auto first = debited.begin();
+        std::rotate(std::upper_bound(first, first + i, debited[i], byCredits),
+                    first + i,
+                    first + i + 1);
+    }
+    // merge the debited stations back into the list, starting from the back of the list.
+    // Debited stations follow the remaining stations having the same credits
+    for (std::size_t pos = staList.size(); nDebited > 0;)
+    {
+        if (nKept > 0 && byCredits(debited[nDebited - 1], staList[nKept - 1]))
+        {
+            staList[--pos] = staList[--nKept];
+        }
+        else
+        {
+            staList[--pos] = debited[--nDebited];
+        }
+    }
+}
 
-        candidate.first->credits -= debitsPerMhz * HeRu::GetBandwidth(mapIt->second.ru.GetRuType());
+Time
+RrMultiUserScheduler::GetLatencyBudget(AcIndex ac) const
+{
+    switch (ac)
+    {
+    case AC_BE:
+        return m_latencyBudgetBe;
+    case AC_BK:
+        return m_latencyBudgetBk;
+    case AC_VI:
+        return m_latencyBudgetVi;
+    case AC_VO:
+        return m_latencyBudgetVo;
+    default:
+        NS_ABORT_MSG("Invalid AC: " << ac);
+        return Time();
     }
-    
-    // sort the list in decreasing order of credits
-    staList.sort([](const MasterInfo& a, const MasterInfo& b) { 
-     
-        return a.credits > b.credits; });
+}
+
+double
+RrMultiUserScheduler::GetAvgThroughput(uint16_t aid, bool ul) const
+{
+    const auto& entry = m_staTable[aid];
+    const Time elapsed = Simulator::Now() - entry.avgTputTime[ul];
+    return entry.avgTput[ul] * std::exp(-elapsed.GetSeconds() / m_pfTimeConstant.GetSeconds());
+}
+
+void
+RrMultiUserScheduler::UpdateAvgThroughput(uint16_t aid, bool ul, double bits)
+{
+    NS_LOG_FUNCTION(this << aid << ul << bits);
+
+    auto& entry = m_staTable[aid];
+    entry.avgTput[ul] = GetAvgThroughput(aid, ul) + bits / m_pfTimeConstant.GetSeconds();
+    entry.avgTputTime[ul] = Simulator::Now();
+    NS_LOG_DEBUG("Average " << (ul ? "UL" : "DL") << " throughput of station with AID " << aid
+                            << ": " << entry.avgTput[ul] << " bps");
+}
+
+double
+RrMultiUserScheduler::GetPfMetric(uint16_t aid, bool ul, const WifiTxVector& suTxVector) const
+{
+    // stations that have not been served recently have a (nearly) null average
+    // throughput, hence the average is bounded from below to avoid a division by zero
+    const double rate = suTxVector.GetMode().GetDataRate(suTxVector);
+    return rate / std::max(GetAvgThroughput(aid, ul), 1.0);
 }
 
 MultiUserScheduler::DlMuInfo
 RrMultiUserScheduler::ComputeDlMuInfo()
 {
     NS_LOG_FUNCTION(this);
-    // std::cout << "At time "<< Simulator::Now()<<" ComputeDlMuInfo called"<<"\n";
     if (m_candidates.empty())
     {
         return DlMuInfo();
@@ -2266,7 +2488,6 @@ RrMultiUserScheduler::ComputeDlMuInfo()
 
     DlMuInfo dlMuInfo;
     std::swap(dlMuInfo.txParams.m_txVector, m_txParams.m_txVector);
-    // std::cout << "finaltx called for DL"<<"\n";
     FinalizeTxVector(dlMuInfo.txParams.m_txVector, m_dlschedulerLogic, false, true);
 
     m_txParams.Clear();
@@ -2296,8 +2517,10 @@ RrMultiUserScheduler::ComputeDlMuInfo()
         mpdu = candidate.second;
         
         NS_ASSERT(mpdu);
-        uint8_t tid = mpdu->GetHeader().GetQosTid();
-        NS_ASSERT_MSG(mpdu->GetOriginal()->GetHeader().GetAddr1() == candidate.first->address,
+        uint8_t tid = m_dlStaInfo[candidate.first].tid;
+        NS_ASSERT(mpdu->GetHeader().GetQosTid() == tid);
+        NS_ASSERT_MSG(mpdu->GetOriginal()->GetHeader().GetAddr1() ==
+                          m_staTable[candidate.first].address,
                       "RA of the stored MPDU must match the stored address");
 
         NS_ASSERT(mpdu->IsQueued());
@@ -2324,32 +2547,33 @@ RrMultiUserScheduler::ComputeDlMuInfo()
             GetHeFem(m_linkId)->GetMpduAggregator()->GetNextAmpdu(item,
                                                                   dlMuInfo.txParams,
                                                                   m_availableTime);
-       // item->
-
         if (mpduList.size() > 1)
         {
             // A-MPDU aggregation succeeded, update psduMap
-            // std::cout<<"AMPDU aggregation done :"<<candidate.first->address<<"\n";
-            dlMuInfo.psduMap[candidate.first->aid] = Create<WifiPsdu>(std::move(mpduList));
-
+            dlMuInfo.psduMap[candidate.first] = Create<WifiPsdu>(std::move(mpduList));
         }
         else
         {
-            
-            // std::cout<<"AMPDU aggregation not done"<<candidate.first->address<<"\n";
-            dlMuInfo.psduMap[candidate.first->aid] = Create<WifiPsdu>(item, true);
+            dlMuInfo.psduMap[candidate.first] = Create<WifiPsdu>(item, true);
         }
-
-        // std::cout<<"AMPDU aggregation not done"<<candidate.first->address<<"\n";
-        //     dlMuInfo.psduMap[candidate.first->aid] = Create<WifiPsdu>(item, true);
     }
 
     AcIndex primaryAc = m_edca->GetAccessCategory();
     UpdateCredits(m_staListDl[primaryAc],
+                  primaryAc,
                   dlMuInfo.txParams.m_txDuration,
                   dlMuInfo.txParams.m_txVector);
+    if (m_dlschedulerLogic == "PropFair")
+    {
+        for (const auto& [aid, psdu] : dlMuInfo.psduMap)
+        {
+            UpdateAvgThroughput(aid, false, psdu->GetSize() * 8.0);
+        }
+    }
+    NotifyMuTx(false, dlMuInfo.txParams.m_txDuration);
+    ++m_metrics.nDlMuPpdus;
 
-    NS_LOG_DEBUG("Next station to serve has AID=" << m_staListDl[primaryAc].front().aid);
+    NS_LOG_DEBUG("Next station to serve has AID=" << m_staListDl[primaryAc].front());
 
     return dlMuInfo;
 }
@@ -22,8 +22,13 @@
 
 #include "multi-user-scheduler.h"
 
-#include <list>
 #include <algorithm>
+#include <array>
+#ifdef NS3_RR_MU_SCHEDULER_TRACE
+#include <fstream>
+#endif
+#include <optional>
+#include <vector>
 
 namespace ns3
 {
@@ -53,6 +58,89 @@ class RrMultiUserScheduler : public MultiUserScheduler
     RrMultiUserScheduler();
     ~RrMultiUserScheduler() override;
 
+    /// Maximum number of RUs in a HE PPDU (i.e., 26-tone RUs in a 160 MHz channel)
+    static constexpr std::size_t MAX_RUS = 74;
+
+    /// RU assigned to each candidate station (in the order of the list of candidates)
+    typedef std::array<std::optional<HeRu::RuSpec>, MAX_RUS> PropAllocation;
+
+    /// Tone demand (in units of 26-tone RUs) of each candidate station
+    typedef std::array<uint8_t, MAX_RUS> ToneDemand;
+
+    /**
+     * Pack non-overlapping RUs of (possibly) different sizes in the channel, given the
+     * tone demand of each candidate station. The tone budget of all the channel widths
+     * is precomputed. Each station is assigned the largest RU not exceeding its demand,
+     * tones left unassigned due to rounding are used to enlarge the assigned RUs and
+     * stations that did not get an RU are assigned a 26-tone RU, if any is left.
+     * The packing can always be signaled in HE-SIG-B: a 20 MHz subchannel only holds
+     * RUs of one type, only the last used subchannel may be partially assigned and
+     * the center 26-tone RU of an 80 MHz channel is never assigned.
+     *
+     * \param demand the tone demand of each candidate station
+     * \param nStations the number of candidate stations
+     * \param ch_width the channel width in MHz (20, 40, 80 or 160)
+     * \param[out] allocation the RU assigned to each candidate station, if any
+     * \return the number of stations that are assigned an RU
+     */
+    static std::size_t PackRus(const ToneDemand& demand,
+                               std::size_t nStations,
+                               uint16_t ch_width,
+                               PropAllocation& allocation);
+
+    /**
+     * Counters accumulated by this scheduler since its creation or the last reset
+     */
+    struct Metrics
+    {
+        Time bsrpTime;         //!< time spent in BSRP TF exchanges
+        Time basicTime;        //!< time spent in Basic TF exchanges
+        Time ulTime;           //!< time granted to stations for TB PPDUs solicited by Basic TFs
+        uint64_t nBsrpTfs{0};  //!< number of BSRP TFs sent
+        uint64_t nBasicTfs{0}; //!< number of Basic TFs sent
+        uint64_t nDlMuPpdus{0}; //!< number of DL MU PPDUs sent
+    };
+
+    /**
+     * \return the counters accumulated by this scheduler
+     */
+    const Metrics& GetMetrics() const;
+
+    /**
+     * Reset the counters accumulated by this scheduler.
+     */
+    void ResetMetrics();
+
+    /**
+     * Events recorded in the binary scheduler trace. The trace is only available if
+     * NS3_RR_MU_SCHEDULER_TRACE is defined at build time.
+     */
+    enum TraceEvent : uint16_t
+    {
+        TRACE_STA_ASSOCIATED = 0, //!< a station associated (aid)
+        TRACE_STA_DEASSOCIATED,   //!< a station deassociated (aid)
+        TRACE_UL_BUFFER_STATUS,   //!< buffer status of a station (aid, arg0 = bytes)
+        TRACE_UL_STA_SKIPPED,     //!< a station cannot be solicited (aid)
+        TRACE_UL_STA_DURATION,    //!< time to send the buffer on the RU (aid, arg1 = ns)
+        TRACE_BASIC_TF,           //!< Basic TF (arg0 = UL Length, arg1 = TB PPDU duration in ns)
+        TRACE_DL_RU_TYPE,         //!< equal-sized DL RUs (arg0 = count, arg1 = RU type)
+        TRACE_BSRP_RU_TYPE,       //!< equal-sized BSRP RUs (arg0 = count, arg1 = RU type)
+        TRACE_DL_RU,              //!< RU assigned in DL (aid, arg0 = encoded RU)
+    };
+
+    /**
+     * Fixed-size record of the binary scheduler trace. RUs are encoded as
+     * (primary80 << 15) | (RU type << 8) | RU index.
+     */
+    struct TraceRecord
+    {
+        int64_t time;   //!< simulation time in nanoseconds
+        uint16_t event; //!< the TraceEvent
+        uint16_t aid;   //!< the AID of the station, if any
+        uint32_t arg0;  //!< first event-specific argument
+        int64_t arg1;   //!< second event-specific argument
+    };
+
   protected:
     void DoDispose() override;
     void DoInitialize() override;
@@ -79,6 +167,20 @@ class RrMultiUserScheduler : public MultiUserScheduler
      */
     virtual TxFormat TrySendingBasicTf();
 
+    /**
+     * Select the duration of the TB PPDU solicited by a Basic Trigger Frame that
+     * maximizes the number of bytes delivered per unit of TXOP time, given the
+     * buffer status, the RU and the MCS of every solicited station. Stations that
+     * would pad their TB PPDU are assigned the smallest RU, among those included
+     * in the RU they were assigned, that allows them to transmit all their bytes.
+     *
+     * \param txVector the TXVECTOR of the TB PPDU (RUs may be shrunk on return)
+     * \param maxDuration the maximum duration of the TB PPDU
+     * \param overhead the TXOP time spent for the UL MU exchange besides the TB PPDU
+     * \return the selected duration of the TB PPDU
+     */
+    Time PlanUlDuration(WifiTxVector& txVector, Time maxDuration, Time overhead);
+
     /**
      * Check if it is possible to send a DL MU PPDU given the current
      * time limits.
@@ -89,13 +191,45 @@ class RrMultiUserScheduler : public MultiUserScheduler
      */
     virtual TxFormat TrySendingDlMuPpdu();
 
+    /**
+     * Check whether the DL/UL ratio mode allows to attempt an UL MU transmission. In
+     * the Fixed mode, a new round is started if the current one is over.
+     *
+     * \return true if an UL MU transmission can be attempted
+     */
+    bool IsUlMuAllowed();
+
+    /**
+     * Notify the DL/UL ratio controller that a MU transmission is taking place.
+     *
+     * \param ul whether the transmission is an UL MU transmission solicited by a Basic TF
+     * \param txDuration the duration of the DL MU PPDU or of the TB PPDUs
+     */
+    void NotifyMuTx(bool ul, Time txDuration);
+
+    /**
+     * Notify the DL/UL ratio controller that no DL MU PPDU could be built. In the Fixed
+     * mode, the DL MU PPDUs left in the current round are given up, so that UL MU
+     * transmissions are not blocked until a DL MU PPDU is built.
+     */
+    void NotifyNoDlMuTx();
+
+    /**
+     * Notify the DL/UL ratio controller of the amount of buffered bytes.
+     *
+     * \param ul whether the bytes are buffered by the stations or by the AP
+     * \param bytes the amount of buffered bytes
+     */
+    void NotifyBacklog(bool ul, double bytes);
+
     /**
      * Compute a TXVECTOR that can be used to construct a Trigger Frame to solicit
      * transmissions from suitable stations, i.e., stations that have established a
      * BlockAck agreement with the AP and for which the given predicate returns true.
      *
      * \tparam Func \deduced the type of the given predicate
-     * \param canBeSolicited a predicate returning false for stations that shall not be solicited
+     * \param canBeSolicited a predicate taking the AID of a station and returning false
+     *                       for stations that shall not be solicited
      * \return a TXVECTOR that can be used to construct a Trigger Frame to solicit
      *         transmissions from suitable stations
      */
@@ -117,16 +251,54 @@ class RrMultiUserScheduler : public MultiUserScheduler
      */
     void NotifyStationDeassociated(uint16_t aid, Mac48Address address);
 
+    /// Number of credit columns of the station table: one per AC (DL) plus one for UL
+    static constexpr std::size_t N_CREDIT_COLUMNS = AC_BE_NQOS + 1;
+    /// Column of the station table holding the UL credits
+    static constexpr std::size_t UL_CREDITS = AC_BE_NQOS;
+
     /**
-     * Information used to sort stations
+     * Entry of the station table, which is indexed by AID
      */
-    struct MasterInfo
+    struct StaEntry
     {
-        uint16_t aid;         //!< station's AID
-        Mac48Address address; //!< station's MAC Address
-        double credits;       //!< credits accumulated by the station
+        Mac48Address address; //!< station's (MLD or link) MAC Address
+        bool listed{false};   //!< whether the station is in the lists of stations
+        std::array<double, N_CREDIT_COLUMNS>
+            credits{};        //!< credits per list (DL per AC, UL), net of the list offset
+        std::array<double, 2> avgTput{}; //!< average served throughput (bps), DL and UL
+        std::array<Time, 2> avgTputTime; //!< time the average throughput was last updated
+        double pfMetric{0};   //!< PF metric computed by the last decision (PropFair logic)
     };
 
+    /**
+     * \param aid the AID of the station
+     * \param ul whether to return the UL or the DL average throughput
+     * \return the exponentially averaged throughput (bps) served to the given station,
+     *         decayed up to the current time
+     */
+    double GetAvgThroughput(uint16_t aid, bool ul) const;
+
+    /**
+     * Update the exponentially averaged throughput of the given station, which is
+     * being served the given amount of bits. The average decays with time constant
+     * m_pfTimeConstant, so stations that are not served are only updated (lazily)
+     * when they are served again.
+     *
+     * \param aid the AID of the station
+     * \param ul whether the station is transmitting (UL) or receiving (DL) the bits
+     * \param bits the amount of bits served to the station
+     */
+    void UpdateAvgThroughput(uint16_t aid, bool ul, double bits);
+
+    /**
+     * \param aid the AID of the station
+     * \param ul whether to compute the UL or the DL PF metric
+     * \param suTxVector the SU TXVECTOR used to transmit to the station
+     * \return the PF metric of the given station, i.e., the rate achievable with the
+     *         given SU TXVECTOR divided by the average served throughput
+     */
+    double GetPfMetric(uint16_t aid, bool ul, const WifiTxVector& suTxVector) const;
+
     /**
      * Finalize the given TXVECTOR by only including the largest subset of the
      * current set of candidate stations that can be allocated equal-sized RUs
@@ -139,26 +311,178 @@ class RrMultiUserScheduler : public MultiUserScheduler
      * \param txVector the given TXVECTOR
      */
     void FinalizeTxVector(WifiTxVector& txVector, std::string scheduler_logic, bool ul, bool basictf);
+
+    /**
+     * \param ul whether to check the UL or the DL scheduler logic
+     * \return whether the scheduler logic packs RUs of (possibly) different sizes based
+     *         on the weight of the candidate stations (Mixed, PropFair and, for DL, Edf)
+     */
+    bool IsRuPackingLogic(bool ul) const;
+
+    /**
+     * Assign the candidate stations RUs of (possibly) different sizes, as packed by
+     * prop_scheduler_fun, in the given TXVECTOR. With the PropFair logic, candidate
+     * stations are first sorted by decreasing PF metric. Candidate stations that are
+     * not assigned an RU are removed from the set of candidate stations.
+     *
+     * \param txVector the given TXVECTOR
+     * \param ul whether the TXVECTOR is used to solicit TB PPDUs or to send a DL MU PPDU
+     */
+    void AssignPackedRus(WifiTxVector& txVector, bool ul);
     /**
      * Update credits of the stations in the given list considering that a PPDU having
      * the given duration is being transmitted or solicited by using the given TXVECTOR.
+     * The credits of a station are the sum of its credits field and the credit offset
+     * of the list (capped to the max amount of credits), so that crediting all the
+     * stations only takes updating the offset. Only the candidate stations, which are
+     * debited, are then moved to keep the list sorted in decreasing order of credits.
      *
-     * \param staList the list of stations
+     * \param staList the list of (AIDs of) stations
+     * \param column the credit column of the list of stations in the station table
      * \param txDuration the TX duration of the PPDU being transmitted or solicited
      * \param txVector the TXVECTOR for the PPDU being transmitted or solicited
      */
-    void UpdateCredits(std::list<MasterInfo>& staList,
+    void UpdateCredits(std::vector<uint16_t>& staList,
+                       std::size_t column,
                        Time txDuration,
                        const WifiTxVector& txVector);
 
-    std::vector<HeRu::RuSpec> prop_scheduler_fun(std::list<std::pair<std::list<MasterInfo>::iterator, Ptr<WifiMpdu>>> m_candidates, uint16_t ch_width, bool ul);
-    
+    /**
+     * Information stored for candidate stations: the AID and the MPDU to send (DL)
+     */
+    typedef std::pair<uint16_t, Ptr<WifiMpdu>> CandidateInfo;
 
+    /**
+     * Information about a station retrieved from the MAC when looking for candidate
+     * stations for a DL MU PPDU. It is retrieved once per DL MU PPDU and reused by
+     * the subsequent stages (RU allocation, computation of the DL MU info).
+     */
+    struct DlStaInfo
+    {
+        Ptr<WifiMpdu> mpdu;     //!< peeked MPDU (null if no frame to send to the station)
+        uint8_t tid{0};         //!< TID of the peeked MPDU
+        uint32_t queueSize{0};  //!< size of the queue of the TID of the peeked MPDU
+        uint8_t mcs{0};         //!< MCS of the SU TXVECTOR (set if tentatively added to the PPDU)
+        uint8_t nss{1};         //!< NSS of the SU TXVECTOR (set if tentatively added to the PPDU)
+        Time deadline;          //!< deadline of the peeked MPDU (set with the Edf logic)
+    };
+
+    /**
+     * \param ac the given AC
+     * \return the latency budget of the frames of the given AC (Edf logic)
+     */
+    Time GetLatencyBudget(AcIndex ac) const;
 
     /**
-     * Information stored for candidate stations
+     * Peek the first frame of the given TID addressed to the given station and store
+     * it, along with the queue size (and the deadline or PF metric, depending on the
+     * scheduler logic), in the DL info of the station.
+     *
+     * \param aid the AID of the station
+     * \param tid the TID
+     * \return whether the AP has a frame of the given TID to send to the station
      */
-    typedef std::pair<std::list<MasterInfo>::iterator, Ptr<WifiMpdu>> CandidateInfo;
+    bool PeekDlFrame(uint16_t aid, uint8_t tid);
+
+    /**
+     * Visit every station in the list of the given AC to find the first TID for which
+     * the AP has a frame to send and rank the stations having frames to send. The
+     * stations to consider for the DL MU PPDUs of the lookahead plan are sorted.
+     *
+     * \param primaryAc the AC that gained channel access
+     */
+    void RankDlStations(AcIndex primaryAc);
+
+    /**
+     * Sort the entries of the DL ranking that are not sorted yet, until the first n
+     * entries of the ranking are sorted. The entries left unsorted are only known to
+     * rank worse than the sorted ones.
+     *
+     * \param n the number of entries of the DL ranking to sort
+     */
+    void SortDlRanking(std::size_t n);
+
+    /**
+     * Ranked station of the DL lookahead plan
+     */
+    struct DlPlanEntry
+    {
+        uint16_t aid;       //!< AID of the station
+        uint8_t tid;        //!< TID of the frames to send to the station
+        uint32_t queueSize; //!< size of the queue of the TID when the plan was made
+    };
+
+    /**
+     * Plan of the next DL MU PPDUs, made from one snapshot of the queues
+     */
+    struct DlPlan
+    {
+        AcIndex ac{AC_UNDEF};                  //!< primary AC for which the plan was made
+        std::vector<DlPlanEntry> stations;     //!< ranked stations, split in consecutive groups
+        std::size_t groupSize{0};              //!< stations to consider for a DL MU PPDU
+        std::size_t next{0};                   //!< first station of the group of the next PPDU
+        uint32_t ppdusLeft{0};                 //!< DL MU PPDUs of the plan not built yet
+        std::size_t count{0};                  //!< number of stations assigned an RU
+        HeRu::RuType ruType{HeRu::RU_26_TONE}; //!< RU type (equal-sized RUs)
+        std::size_t nCentral26TonesRus{0};     //!< number of central 26-tone RUs
+    };
+
+    /**
+     * Make a plan for the next DL MU PPDUs from the current ranking of the stations,
+     * if lookahead is enabled. The DL MU PPDU being prepared is the first of the plan.
+     * The ranked stations are split into groups of as many stations as the candidates
+     * of a DL MU PPDU and the plan ends when the groups are used up, hence no station
+     * is considered twice within a plan.
+     *
+     * \param primaryAc the AC that gained channel access
+     * \param count the number of stations assigned an RU
+     * \param ruType the RU type
+     * \param nCentral26TonesRus the number of central 26-tone RUs
+     */
+    void MakeDlPlan(AcIndex primaryAc,
+                    std::size_t count,
+                    HeRu::RuType ruType,
+                    std::size_t nCentral26TonesRus);
+
+    /**
+     * If the DL lookahead plan is valid for the given AC, rank the stations of the
+     * next group of the plan after checking that their queues have not changed beyond
+     * the threshold. Otherwise, the plan is dropped. The group is used up by
+     * TrySendingDlMuPpdu only if a DL MU PPDU is built.
+     *
+     * \param primaryAc the AC that gained channel access
+     * \return whether the plan has been used
+     */
+    bool UseDlPlan(AcIndex primaryAc);
+
+    /**
+     * Entry of the ranking of the stations to which the AP has frames to send
+     */
+    struct DlQueueRank
+    {
+        uint16_t aid;                           //!< AID of the station
+        uint32_t queueSize;                     //!< size of the queue for the station
+        std::size_t position;                   //!< position of the station in the DL list
+    };
+
+    /**
+     * Assign RUs of (possibly) different sizes to the given candidate stations, in
+     * proportion to their queue sizes (or their PF metrics with the PropFair logic, or
+     * the rate needed to send their queue before the deadline with the Edf logic).
+     * Each station demands a share of the tone budget of the channel (i.e., the number
+     * of 26-tone RUs it contains) proportional to its weight and RUs are then packed
+     * by PackRus.
+     *
+     * \param candidates the list of candidate stations
+     * \param ch_width the channel width in MHz (20, 40, 80 or 160)
+     * \param ul whether queue sizes are those reported by stations (UL) or those of the AP (DL)
+     * \param[out] allocation the RU assigned to each candidate station, if any
+     * \return the number of stations that are assigned an RU
+     */
+    std::size_t prop_scheduler_fun(const std::vector<CandidateInfo>& candidates,
+                                   uint16_t ch_width,
+                                   bool ul,
+                                   PropAllocation& allocation);
 
     uint8_t m_nStations;         //!< Number of stations/slots to fill
     bool m_enableTxopSharing;    //!< allow A-MPDUs of different TIDs in a DL MU PPDU
@@ -167,18 +491,76 @@ class RrMultiUserScheduler : public MultiUserScheduler
     bool m_enableBsrp;           //!< send a BSRP before an UL MU transmission
     bool m_useCentral26TonesRus; //!< whether to allocate central 26-tone RUs
     uint32_t m_ulPsduSize;       //!< the size in byte of the solicited PSDU
-    std::map<AcIndex, std::list<MasterInfo>>
-        m_staListDl;  
-                         //!< Per-AC list of stations (next to serve for DL first)
-struct cmp{
-  bool operator()(const MasterInfo& a, const MasterInfo& b) const{
-    return a.credits<b.credits;
-  }
-};
-  std:: map<ns3::RrMultiUserScheduler::MasterInfo,int,cmp> dlqueueinfo;
-    std::list<MasterInfo> m_staListUl;     //!< List of stations to serve for UL
-    std::list<CandidateInfo> m_candidates; //!< Candidate stations for MU TX
+    std::vector<StaEntry> m_staTable;      //!< Table of the associated stations, indexed by AID
+    std::array<double, N_CREDIT_COLUMNS> m_creditOffset{}; //!< Credit offset of each list
+    std::array<std::vector<uint16_t>, AC_BE_NQOS>
+        m_staListDl;                       //!< Per-AC list of AIDs (next to serve for DL first)
+    std::vector<DlStaInfo> m_dlStaInfo;    //!< Per-AID DL info, refreshed every DL MU PPDU
+    std::vector<DlQueueRank> m_dlRanking;  //!< Stations with DL frames, best ranked first
+    std::size_t m_dlRankingSorted{0};      //!< number of sorted entries of the DL ranking
+    DlPlan m_dlPlan;                       //!< Plan of the next DL MU PPDUs (lookahead)
+    uint32_t m_lookahead;                  //!< number of DL MU PPDUs of a plan
+    double m_lookaheadThreshold;           //!< relative queue change invalidating the plan
+
+    /**
+     * Information used to plan the duration of a TB PPDU
+     */
+    struct UlStaPlan
+    {
+        uint16_t aid;   //!< station's AID
+        uint32_t bytes; //!< bytes buffered by the station
+        Time duration;  //!< time to transmit the buffered bytes on the assigned RU
+        double rate;    //!< rate (bytes per second) on the assigned RU
+    };
+
+    std::vector<UlStaPlan> m_ulPlan;       //!< Plan of the solicited stations
+    std::string m_ulDurationPolicy;        //!< how the duration of TB PPDUs is determined
+    std::string m_dlUlRatioMode;           //!< how DL MU and UL MU transmissions are interleaved
+    uint32_t m_dlFraction;                 //!< DL MU PPDUs per round (Fixed mode)
+    uint32_t m_ulFraction;                 //!< UL MU transmissions per round (Fixed mode)
+    uint32_t m_dlCount{0};                 //!< DL MU PPDUs left in the current round
+    uint32_t m_ulCount{0};                 //!< UL MU transmissions left in the current round
+    double m_ratioAlpha;                   //!< weight of the newest sample (Adaptive mode)
+    double m_dlBacklog{0};                 //!< average bytes buffered by the AP (Adaptive mode)
+    double m_ulBacklog{0};                 //!< average bytes buffered by stations (Adaptive mode)
+    double m_dlAirtime{0};                 //!< average DL MU airtime in us (Adaptive mode)
+    double m_ulAirtime{0};                 //!< average UL MU airtime in us (Adaptive mode)
+    uint32_t m_bsrpPeriod;                 //!< BSRP TF opportunities per BSRP TF actually sent
+    uint32_t m_bsrpCount{0};               //!< BSRP TF opportunities left before trying one
+    bool m_lastTxBsrp{false};              //!< whether the last MU TX was a BSRP TF exchange
+    bool m_lastTxBasic{false};             //!< whether the last MU TX was a Basic TF exchange
+    Time m_lastTxStart;                    //!< start time of the last BSRP/Basic TF exchange
+    Metrics m_metrics;                     //!< counters accumulated by this scheduler
+#ifdef NS3_RR_MU_SCHEDULER_TRACE
+    /**
+     * Append a record to the binary scheduler trace.
+     *
+     * \param event the event
+     * \param aid the AID of the station, if any
+     * \param arg0 first event-specific argument
+     * \param arg1 second event-specific argument
+     */
+    void Trace(TraceEvent event, uint16_t aid, uint32_t arg0 = 0, int64_t arg1 = 0);
+
+    /**
+     * Write the buffered trace records to the trace file and empty the buffer.
+     */
+    void FlushTrace();
+
+    std::string m_traceFile;                 //!< prefix of the binary trace file name
+    uint32_t m_traceBufferSize;              //!< number of records buffered before writing
+    std::vector<TraceRecord> m_traceBuffer;  //!< buffered trace records
+    std::ofstream m_traceStream;             //!< the binary trace file
+#endif
+    std::vector<uint16_t> m_staListUl;     //!< List of AIDs of stations to serve for UL
+    std::vector<CandidateInfo> m_candidates; //!< Candidate stations for MU TX
     Time m_maxCredits;                     //!< Max amount of credits a station can have
+    Time m_pfTimeConstant;                 //!< time constant of the average throughput (PF)
+    Time m_latencyBudgetBe;                //!< latency budget of AC_BE frames (Edf)
+    Time m_latencyBudgetBk;                //!< latency budget of AC_BK frames (Edf)
+    Time m_latencyBudgetVi;                //!< latency budget of AC_VI frames (Edf)
+    Time m_latencyBudgetVo;                //!< latency budget of AC_VO frames (Edf)
+    Time m_edfMinSlack;                    //!< min time left before the deadline (Edf)
     CtrlTriggerHeader m_trigger;           //!< Trigger Frame to send
     WifiMacHeader m_triggerMacHdr;         //!< MAC header for Trigger Frame
     WifiTxParameters m_txParams;           //!< TX parameters
@@ -40,6 +40,7 @@
 #include "ns3/on-off-helper.h"
 #include "ns3/bulk-send-helper.h"
 #include "ns3/bulk-send-application.h"
+#include "ns3/data-rate.h"
 #include "ns3/ping-helper.h"
 #include "ns3/multi-model-spectrum-channel.h"
 #include "ns3/wifi-mac-queue.h"
@@ -51,11 +52,16 @@
 #include "ns3/wifi-acknowledgment.h"
 #include "ns3/trace-helper.h"
 #include "ns3/wifi-mpdu.h"
+#include "ns3/wifi-phy-state-helper.h"
+#include "ns3/node-list.h"
+#include "ns3/rr-multi-user-scheduler.h"
 // #include "ns3/regular-wifi-mac.h"
 // #include "ns3/v4ping-helper.h"
 
 
 #include <vector>
+#include <array>
+#include <deque>
 #include <map>
 #include <unordered_map>
 #include <set>
@@ -110,14 +116,9 @@ void
 TraceCwnd(Ptr<BulkSendApplication> sender, uint32_t node, uint32_t cwndWindow, Callback<void, uint32_t, uint32_t> CwndTrace)
 {
     std::cout << "tracecwnd called"<<"\n";
-    Config::ConnectWithoutContext("/NodeList/" + std::to_string(node) +
-                                      "/$ns3::TcpL4Protocol/SocketList/" +
-                                      std::to_string(cwndWindow) + "/CongestionWindow",
-                                  CwndTrace);
 
       // auto x = sender->GetNode()->GetId();
-      sender->GetSocket()->TraceConnectWithoutContext("CongestionWindow",
-                                             MakeBoundCallback(&CwndChange_new));
+      sender->GetSocket()->TraceConnectWithoutContext("CongestionWindow", CwndTrace);
 
 }
 
@@ -161,7 +162,31 @@ TraceCwnd(Ptr<BulkSendApplication> sender, uint32_t node, uint32_t cwndWindow, C
 class WifiOfdmaExample
 {
 public:
-  // Helper class to store min, max, avg and count statistics
+  // Logarithmically binned histogram (DDSketch) of non-negative samples. Quantiles are
+  // estimated with a relative error of at most RELATIVE_ACCURACY, as long as the samples
+  // span less than MAX_BUCKETS buckets (otherwise, the lowest buckets are collapsed)
+  struct QuantileSketch
+  {
+    static constexpr double RELATIVE_ACCURACY = 0.01;
+    static constexpr std::size_t MAX_BUCKETS = 2048;
+    static constexpr double MIN_INDEXABLE = 1e-9;   // smaller samples are counted as zeros
+
+    void Add (double value);
+    bool Remove (double value);   // return false if no sample was found in the bucket
+    void Merge (const QuantileSketch& rhs);
+    double GetValueAtRank (uint64_t rank) const;   // rank is 0-based
+
+  private:
+    static int32_t GetIndex (double value);
+    uint64_t& GetBucket (int32_t index);
+
+    int32_t m_offset {0};             // index of the first bucket
+    std::vector<uint64_t> m_buckets;  // number of samples per bucket
+    uint64_t m_zeroCount {0};         // number of samples not exceeding MIN_INDEXABLE
+  };
+
+  // Helper class to store exact min, max, avg and count statistics and approximate
+  // quantiles of a stream of samples in a bounded amount of memory
   template <typename T>
   struct Stats
   {
@@ -170,13 +195,75 @@ public:
     void RemoveSample (T value);
     Stats<T>& operator+= (const Stats<T>& rhs);  // merge samples
 
-    std::multiset<T> m_samples;
+    uint64_t GetCount () const;
+    double GetSum () const;
+    double GetMean () const;
+    double GetStdDev () const;
+    double GetQuantile (double q) const;   // exact for q = 0 (min) and q = 1 (max)
+
+    uint64_t m_count {0};
+    double m_sum {0};
+    double m_sumSquares {0};
+    T m_min {};
+    T m_max {};
+    QuantileSketch m_sketch;
+  };
+
+  // Per-AC slots of a node, indexed by AcIndex (AC_BE to AC_VO). A slot is present
+  // only if traffic of the corresponding AC is exchanged
+  template <typename T>
+  struct PerAc
+  {
+    static constexpr std::size_t N_ACS = 4;
+
+    T& Add (AcIndex ac);               // make the slot present and reset it
+    T* Find (AcIndex ac);              // return nullptr if the slot is not present
+    const T* Find (AcIndex ac) const;
+    template <typename FUNC>
+    void ForEach (FUNC f);             // call f (ac, value) for every present slot
+
+    std::array<T, N_ACS> m_values {};
+    uint8_t m_present {0};             // bitmask of present slots
   };
 
-  struct PacketsinFlow  // To keep track of packets in flow which dropped and which received
-  { 
+  // To keep track of packets in flow which dropped and which received. Packets are
+  // identified by their sequence number (starting at 0) in the flow, one bit each
+  struct DeliveryBitmap
+  {
+    uint64_t Add ();                     // add a packet and return its sequence number
+    void MarkDelivered (uint64_t seq);
+    bool IsDelivered (uint64_t seq) const;
+    uint64_t GetCount () const;          // number of packets added
+    uint64_t GetDelivered () const;      // number of packets marked as delivered
+    uint64_t GetLost () const;           // number of packets not marked as delivered
+
+  private:
+    std::vector<uint64_t> m_words;
+    uint64_t m_count {0};
+    uint64_t m_delivered {0};
+  };
 
-    std::multiset<std::pair<uint64_t /* UID */,bool>> m_samples;
+  // Bytes received in consecutive time bins of fixed width, kept in a ring buffer
+  // allocated once when recording starts. When the buffer is full, the oldest bins
+  // are overwritten
+  struct ThroughputSeries
+  {
+    void Start (Time start, Time binWidth, std::size_t capacity);
+    void Add (Time now, uint32_t bytes);
+    void AdvanceTo (Time now);           // close all the bins ending before now
+    uint64_t GetFirstBin () const;       // index of the oldest bin still stored
+    uint64_t GetEndBin () const;         // index past the last closed bin
+    uint64_t GetBytes (uint64_t bin) const;
+    Time GetBinStart (uint64_t bin) const;
+    Time GetBinWidth () const;
+
+  private:
+    void MoveTo (uint64_t bin);          // make bin the current bin
+
+    Time m_start;
+    Time m_binWidth;
+    std::vector<uint64_t> m_bins;
+    uint64_t m_currentBin {0};
   };
 
 
@@ -201,26 +288,63 @@ public:
     Stats<double> m_latency;
     
 
-    PacketsinFlow packetsinFlow, packetsinFlow_mac;
-    Stats<std::pair<uint64_t /* UID */,double> > appLatencies;
+    DeliveryBitmap packetsinFlow, packetsinFlow_mac;
      
     long double m_txBytes {0};
     uint64_t m_txPackets {0};
     uint64_t m_packetsRejectedBySocket{0};
     long double m_rxBytes {0};
     uint64_t m_rxPackets {0};
-    long double m_prevRxBytes {0};
+    ThroughputSeries m_tputSeries;  // bytes received at App per bin
     // 
     uint64_t m_txPackets_mac{0};
     uint64_t m_rxPackets_mac{0};
     long double m_rxBytes_mac {0};
     long double m_txBytes_mac {0};
     /*
-     * For UDP flows, map packet's UID to the time it was transmitted. For TCP flows,
-     * map the total amount of bytes transmitted at the time a packet was sent to
-     * the time the packet was transmitted.
+     * For UDP flows, map packet's UID to the time it was transmitted and to its
+     * sequence number in packetsinFlow.
+     */
+    std::unordered_map<uint64_t, std::pair<Time, uint64_t>> m_inFlightPackets;
+    /*
+     * For TCP flows, the total amount of bytes transmitted at the time a packet was
+     * sent and the time the packet was transmitted, in increasing order of bytes
+     * (hence, of sequence number in packetsinFlow)
      */
-    std::unordered_map<uint64_t, Time> m_inFlightPackets;
+    std::deque<std::pair<uint64_t, Time>> m_inFlightSegments;
+  };
+
+  /*
+   * A class of flows in a traffic profile. A profile is a list of classes separated
+   * by ';' or newlines ('#' starts a comment), each made of whitespace-separated
+   * key=value fields, e.g. "sta=1-4 dir=both ac=VI l4=udp payload=1500 rate=3Mbps":
+   *   sta:     "all" or a comma-separated list of station IDs and ranges "a-b" (or
+   *            "a-" up to the last station), each optionally followed by "/stride"
+   *   dir:     dl, ul or both
+   *   ac:      BE, BK, VI or VO
+   *   l4:      udp or tcp
+   *   payload: bytes (frameSize if omitted)
+   *   rate:    an ns-3 DataRate string (dlFlowDataRate/ulFlowDataRate if omitted)
+   * Fields not given take the default values below.
+   */
+  struct FlowClass
+  {
+    struct StationRange
+    {
+      uint16_t first;
+      uint16_t last;
+      uint16_t stride;
+    };
+
+    bool Matches (uint16_t staId) const;
+
+    std::vector<StationRange> m_stations;  // empty means all stations
+    bool m_dl {true};
+    bool m_ul {true};
+    AcIndex m_ac {AC_BE};
+    decltype (Flow::m_l4Proto) m_l4Proto {Flow::UDP};
+    uint32_t m_payloadSize {0};             // 0 means frameSize
+    double m_dataRate {0};                  // b/s, 0 means dl/ulFlowDataRate
   };
 
   /**
@@ -236,6 +360,10 @@ public:
    * Read the specs of the traffic flows to generate.
    */
   void GenerateTrafficFlows (void);
+  /**
+   * Parse a traffic profile (see FlowClass) and append its classes to m_flowClasses.
+   */
+  void ParseTrafficProfile (const std::string& profile);
   /**
    * Setup nodes, devices and internet stacks.
    */
@@ -256,13 +384,15 @@ public:
    */
   void PrintResults (std::ostream& os);
   /**
-   * Make the current station associate with the AP.
+   * Make the stations of the current batch associate with their AP.
    */
   void StartAssociation (void);
   /**
-   * Make the AP establish a BA agreement with the current station.
+   * Make the AP establish a BA agreement with the given station (0-based index,
+   * OBSS stations follow the stations of the BSS under test), which has just
+   * associated. Start the next batch when the whole current batch is set up.
    */
-  void EstablishBaAgreement (Mac48Address bssid);
+  void EstablishBaAgreement (uint16_t sta, Mac48Address bssid);
   /**
    * Start a client application.
    */
@@ -296,13 +426,13 @@ public:
    */
   void NotifyTxFailed (Ptr<const WifiMpdu> mpdu);
   /**
-   * Report that the lifetime of an MSDU expired.
+   * Report that the lifetime of an MSDU queued by the given node expired.
    */
-  void NotifyMsduExpired (Ptr<const WifiMpdu> mpdu);
+  void NotifyMsduExpired (uint32_t srcNodeId, Ptr<const WifiMpdu> mpdu);
   /**
-   * Report that an MSDU was dropped before enqueue into EDCA queue.
+   * Report that an MSDU was dropped before enqueue into an EDCA queue of the given node.
    */
-  void NotifyMsduRejected (Ptr<const WifiMpdu> mpdu);
+  void NotifyMsduRejected (uint32_t srcNodeId, Ptr<const WifiMpdu> mpdu);
   /**
    * Report that a packet was transmitted by the i-th application.
    */
@@ -320,9 +450,10 @@ public:
    */
   void NotifyMacForwardUp (Ptr<const Packet> p);
   /**
-   * Report that an MSDU was dequeued from the EDCA queue.
+   * Report that an MSDU was dequeued from an EDCA queue of the given node.
    */
-  void NotifyMsduDequeuedFromEdcaQueue (Time maxDelay, Ptr<const WifiMpdu> item);
+  void NotifyMsduDequeuedFromEdcaQueue (Time maxDelay, uint32_t srcNodeId,
+                                        Ptr<const WifiMpdu> item);
   /**
    * Report that PSDUs were forwarded down to the PHY.
    */
@@ -343,20 +474,23 @@ public:
    */
   void NotifyDropAfterDequeue (std::size_t nodeId, AcIndex ac, Ptr<const QueueDiscItem> item, const char* reason);
   /**
-   * Store the per-flow amount of bytes received so far
+   * Write the per-flow throughput time series and compute per-AC statistics of
+   * the throughput per bin
    */
-  void StoreCumulativeRxBytes (void);
+  void FlushThroughputSeries (void);
   /**
-   * Parse context strings of the form "/NodeList/x/DeviceList/y/" to extract the NodeId
+   * Connect (or disconnect) NotifyStateChange to the PHY state trace of every
+   * Wi-Fi device, with the ID of the node bound to the callback
    */
-  uint32_t ContextToNodeId (const std::string &context);
+  void ConnectPhyStateTraces (bool connect);
 
-  void NotifyStateChange (std::string context, Time oldt, Time duration, WifiPhyState newState);
+  void NotifyStateChange (uint32_t nodeId, Time oldt, Time duration, WifiPhyState newState);
 
   void NotifyCwChange (uint32_t oldCw, uint32_t newCw);
   void NotifyBackoffChange (uint32_t backoff);
 
   static const std::map<AcIndex, std::string> m_aciToString;
+  static const std::map<std::string, std::string> m_trafficProfiles;  // built-in profiles
   static uint16_t m_nEcdfSamples;       // by default, minimum, median and maximum
 
 private:
@@ -364,10 +498,10 @@ private:
   void ReadParamList (std::string s, std::vector<T>& vec);
 
   template <typename T, typename FUNC>
-  void PrintStatsWithTotal (std::vector<std::map<AcIndex, T>> v, FUNC select,
+  void PrintStatsWithTotal (const std::vector<PerAc<T>>& v, FUNC select,
                             std::ostream& os, std::string s, std::string s0 = "");
   template <typename T, typename FUNC>
-  void PrintStats (std::vector<std::map<AcIndex, T>> v, FUNC select,
+  void PrintStats (const std::vector<PerAc<T>>& v, FUNC select,
                    std::ostream& os, std::string s, std::string s0 = "");
 
   /* Parameters */
@@ -394,12 +528,8 @@ private:
   bool m_forceDlOfdma{false};
   //enable ofdma
   bool m_enableUlOfdma{true};
-  bool startThroughputcalc{false};
   bool m_enableTxopSharing{false};
   bool m_enableBsrp{true};  
-   double prevTime=0,currTime;
- 
-   uint64_t recvPackets=0;
   //  std::multimap< ns3::Time,uint64_t> tcptime;
    
   bool m_useCentral26TonesRus {false};
@@ -475,9 +605,10 @@ private:
   uint32_t m_tcpInitialCwnd{0}; // TCP initial congestion window size (segments, 0 = use default)
   uint32_t m_tcpMinRto{500}; // TCP minimum retransmit timeout (milliseconds, 0 = use default)
   std::string m_trafficFile; // name of file describing traffic flows to generate
+  std::string m_trafficProfile{"haptic15"}; // built-in profile name or profile spec
+  std::vector<FlowClass> m_flowClasses;
   bool m_verbose{false};
-  uint16_t m_nIntervals{20}; // number of intervals in which the simulation time is divided
-  uint16_t m_elapsedIntervals{0};
+  double m_tputBinWidth{100}; // width of the bins of the throughput time series (ms)
   // std::string m_scheduler = "rr";
   std::string m_dlscheduler = "rr"; 
   std::string m_ulscheduler = "rr";
@@ -498,14 +629,17 @@ private:
   Ipv4InterfaceContainer m_apInterfaces;
   Ipv4InterfaceContainer m_staInterfaces;
   std::vector<Ipv4InterfaceContainer> m_obssStaInterfaces;
-  uint16_t m_currentSta {0};         // index of the current station
+  uint16_t m_currentSta {0};         // index of the first station of the current batch
+  uint16_t m_assocBatchSize {1};     // number of stations associating concurrently
+  uint16_t m_pendingAssoc {0};       // stations of the current batch not yet set up
+  std::vector<bool> m_staSetUp;      // whether each station has been set up
   ApplicationContainer m_sinkApps;
   std::vector<ApplicationContainer> m_obssSinkApps;
   std::vector<Ptr<Application>> m_clientApps;
   std::vector<double> m_clientApps_onTime_Info;
   std::vector<ApplicationContainer> m_obssClientApps;
   std::vector<Flow> m_flows;
-  std::vector<double> Throughputs;
+  std::map<AcIndex, Stats<double>> m_dlTputSeries, m_ulTputSeries; // per-AC throughput per bin (Mbps)
 
   std::vector<uint64_t> m_obssDlRxStart, m_obssDlRxStop;
   std::vector<uint64_t> m_obssUlRxStart, m_obssUlRxStop;
@@ -548,8 +682,8 @@ private:
     Stats<double> ampduRatio;       // ratio of the duration of the A-MPDU sent to (for DL) or received
                                     // from (for UL) a STA to the duration of the DL MU PPDU or HE TB PPDU
   };
-  std::vector<std::map<AcIndex, PairwisePerAcStats>> m_dlPerStaAcStats;   // A vector element per station (DL)
-  std::vector<std::map<AcIndex, PairwisePerAcStats>> m_ulPerStaAcStats;   // A vector element per station (UL)
+  std::vector<PerAc<PairwisePerAcStats>> m_dlPerStaAcStats;   // A vector element per station (DL)
+  std::vector<PerAc<PairwisePerAcStats>> m_ulPerStaAcStats;   // A vector element per station (UL)
 
   // Metrics that can be measured (sender side) for each Access Category
   // and are independent of the receiver
@@ -561,7 +695,7 @@ private:
     Time lastTxTime {Seconds (0)};
     Stats<double> aggregateHoL;     // aggregate Head-of-Line delay
   };
-  std::vector<std::map<AcIndex, PerAcStats>> m_perAcStats;  // first vector element for the AP, then one per STA
+  std::vector<PerAc<PerAcStats>> m_perAcStats;  // first vector element for the AP, then one per STA
 
   struct InFlightPacketInfo
   {
@@ -570,10 +704,13 @@ private:
     AcIndex m_ac;
     Ptr<const Packet> m_ptrToPacket;
     Time m_edcaEnqueueTime {Seconds (0)};  // time the packet was enqueued into an EDCA queue
+    uint64_t m_macSeq {0};                 // sequence number in packetsinFlow_mac
   };
   std::unordered_map<uint64_t /* UID */, std::list<InFlightPacketInfo>> m_inFlightPacketMap;
   
   std::vector<uint64_t> m_nSolicitingBasicTriggerFrames;
+  // counters of the RR MU scheduler of each AP, taken when statistics stop
+  std::vector<std::pair<std::size_t /* AP index */, RrMultiUserScheduler::Metrics>> m_muSchedulerMetrics;
 
   // Function object to compute the hash of a MAC address
   struct MacAddressHash
@@ -582,16 +719,62 @@ private:
   };
 
   std::unordered_map <Mac48Address, uint32_t, MacAddressHash> m_staMacAddressToNodeId;
+  Mac48Address m_apAddress;   // MAC address of the AP of the BSS under test
+
+  // CSV trace file (one header line, one line per record) opened at the first record
+  // and written through a large buffer, which is flushed when full and on destruction
+  class TraceWriter
+  {
+  public:
+    TraceWriter (std::string filename, std::string header);
+    ~TraceWriter ();
+    template <typename... Args>
+    void Write (const Args&... columns);
+    void Flush ();
+
+  private:
+    void Append (const std::string& column);
+    template <typename T>
+    void Append (T column);
+
+    static constexpr std::size_t BUFFER_SIZE = 1 << 20;
+    std::string m_filename;
+    std::string m_header;
+    std::ofstream m_file;
+    std::string m_buffer;
+  };
+
+  TraceWriter m_cwLog {"CwLog.csv", "time_ns,node,old_cw,new_cw"};
+  TraceWriter m_backoffLog {"BackoffLog.csv", "time_ns,node,backoff"};
+  TraceWriter m_phyStateLog {"WifiPhyStateLog.csv", "time_ns,node,start_us,duration_us,state"};
+  TraceWriter m_tputLog {"ThroughputSeries.csv", "bin_start_ms,flow,sta,direction,ac,mbps"};
+  TraceWriter m_muSchedulerLog {"MuSchedulerMetrics.csv",
+                                "ap,bsrp_tfs,basic_tfs,dl_mu_ppdus,bsrp_time_us,basic_time_us,ul_time_us"};
 
   /**
    * Return the ID of the node containing the device having the given address.
    */
   uint32_t MacAddressToNodeId (Mac48Address address);
   /**
-   * Return an iterator to the PairwisePerAcStats object corresponding to the given MPDU header.
+   * Return the RR MU scheduler of the given AP device, or a null pointer if the AP
+   * does not use it.
+   */
+  Ptr<RrMultiUserScheduler> GetRrMuScheduler (Ptr<NetDevice> apDevice) const;
+  /**
+   * Return the PairwisePerAcStats object corresponding to the given transmitter, receiver
+   * and AC, or a null pointer if no such object exists.
+   */
+  PairwisePerAcStats* GetPairwisePerAcStats (Mac48Address src, Mac48Address dst, AcIndex ac);
+  /**
+   * Return the PairwisePerAcStats object corresponding to the given MPDU header, or a null
+   * pointer if no such object exists.
+   */
+  PairwisePerAcStats* GetPairwisePerAcStats (const WifiMacHeader& hdr, AcIndex = AC_UNDEF);
+  /**
+   * Return the PairwisePerAcStats object corresponding to the given QoS data MPDU header
+   * queued by the node having the given ID, or a null pointer if no such object exists.
    */
-  std::pair<std::map<AcIndex, PairwisePerAcStats>::iterator, bool>
-    GetPairwisePerAcStats (const WifiMacHeader& hdr, AcIndex = AC_UNDEF);
+  PairwisePerAcStats* GetPairwisePerAcStats (uint32_t srcNodeId, const WifiMacHeader& hdr);
   /**
    * Return the OBSS id and the index of station having the given id.
    */
@@ -601,23 +784,175 @@ private:
 const std::map<AcIndex, std::string> WifiOfdmaExample::m_aciToString = { {AC_BE, "BE"}, {AC_BK, "BK"},
                                                                          {AC_VI, "VI"}, {AC_VO, "VO"}, };
 
+const std::map<std::string, std::string> WifiOfdmaExample::m_trafficProfiles = {
+  // one BE UDP flow per station and direction
+  {"default", "sta=all"},
+  // video call, audio call, video streaming, file download and haptic stations
+  {"haptic5", "sta=1 ac=VI payload=1500 rate=3Mbps;"
+              "sta=2 ac=VO payload=160 rate=64kbps;"
+              "sta=3 dir=dl ac=BE payload=1500 rate=8Mbps;"
+              "sta=4 dir=dl ac=BE l4=tcp payload=1500 rate=8Mbps;"
+              "sta=5 ac=VO payload=64 rate=512kbps;"
+              "sta=5 dir=ul ac=VI payload=1500 rate=4Mbps"},
+  {"haptic8", "sta=1-2 ac=VI payload=1500 rate=3Mbps;"
+              "sta=3-4 ac=VO payload=160 rate=64kbps;"
+              "sta=5-6 dir=dl ac=BE payload=1500 rate=8Mbps;"
+              "sta=7 dir=dl ac=BE l4=tcp payload=1500 rate=8Mbps;"
+              "sta=8 ac=VO payload=64 rate=512kbps;"
+              "sta=8 dir=ul ac=VI payload=1500 rate=4Mbps"},
+  {"haptic15", "sta=1-4 ac=VI payload=1500 rate=3Mbps;"
+               "sta=5-8 ac=VO payload=160 rate=64kbps;"
+               "sta=9-12 dir=dl ac=BE payload=1500 rate=8Mbps;"
+               "sta=13-14 dir=dl ac=BE l4=tcp payload=1500 rate=8Mbps;"
+               "sta=15 ac=VO payload=64 rate=512kbps;"
+               "sta=15 dir=ul ac=VI payload=1500 rate=4Mbps"},
+};
+
 uint16_t WifiOfdmaExample::m_nEcdfSamples = 3;       // by default, minimum, median and maximum
 
+int32_t
+WifiOfdmaExample::QuantileSketch::GetIndex (double value)
+{
+  static const double logGamma =
+      std::log ((1 + RELATIVE_ACCURACY) / (1 - RELATIVE_ACCURACY));
+  return static_cast<int32_t> (std::ceil (std::log (value) / logGamma));
+}
+
+uint64_t&
+WifiOfdmaExample::QuantileSketch::GetBucket (int32_t index)
+{
+  if (m_buckets.empty ())
+    {
+      m_offset = index;
+      m_buckets.push_back (0);
+    }
+  else if (index < m_offset)
+    {
+      if (m_buckets.size () + (m_offset - index) > MAX_BUCKETS)
+        {
+          // too small a value, count it in the lowest bucket
+          return m_buckets.front ();
+        }
+      m_buckets.insert (m_buckets.begin (), m_offset - index, 0);
+      m_offset = index;
+    }
+  else if (index >= m_offset + static_cast<int32_t> (m_buckets.size ()))
+    {
+      m_buckets.resize (index - m_offset + 1, 0);
+      if (m_buckets.size () > MAX_BUCKETS)
+        {
+          // collapse the lowest buckets into the lowest bucket that is kept
+          std::size_t shift = m_buckets.size () - MAX_BUCKETS;
+          uint64_t low = std::accumulate (m_buckets.begin (), m_buckets.begin () + shift + 1,
+                                          uint64_t (0));
+          m_buckets.erase (m_buckets.begin (), m_buckets.begin () + shift);
+          m_buckets.front () = low;
+          m_offset += shift;
+        }
+    }
+  return m_buckets[index - m_offset];
+}
+
+void
+WifiOfdmaExample::QuantileSketch::Add (double value)
+{
+  if (value <= MIN_INDEXABLE)
+    {
+      m_zeroCount++;
+      return;
+    }
+  GetBucket (GetIndex (value))++;
+}
+
+bool
+WifiOfdmaExample::QuantileSketch::Remove (double value)
+{
+  if (value <= MIN_INDEXABLE)
+    {
+      if (m_zeroCount == 0)
+        {
+          return false;
+        }
+      m_zeroCount--;
+      return true;
+    }
+  if (m_buckets.empty ())
+    {
+      return false;
+    }
+  int32_t index = std::max (GetIndex (value), m_offset);
+  if (index >= m_offset + static_cast<int32_t> (m_buckets.size ())
+      || m_buckets[index - m_offset] == 0)
+    {
+      return false;
+    }
+  m_buckets[index - m_offset]--;
+  return true;
+}
+
+void
+WifiOfdmaExample::QuantileSketch::Merge (const QuantileSketch& rhs)
+{
+  m_zeroCount += rhs.m_zeroCount;
+  for (std::size_t i = 0; i < rhs.m_buckets.size (); i++)
+    {
+      if (rhs.m_buckets[i] > 0)
+        {
+          GetBucket (rhs.m_offset + static_cast<int32_t> (i)) += rhs.m_buckets[i];
+        }
+    }
+}
+
+double
+WifiOfdmaExample::QuantileSketch::GetValueAtRank (uint64_t rank) const
+{
+  if (rank < m_zeroCount || m_buckets.empty ())
+    {
+      return 0;
+    }
+  static const double gamma = (1 + RELATIVE_ACCURACY) / (1 - RELATIVE_ACCURACY);
+  uint64_t cumulative = m_zeroCount;
+  std::size_t i = 0;
+  for (; i + 1 < m_buckets.size (); i++)
+    {
+      cumulative += m_buckets[i];
+      if (cumulative > rank)
+        {
+          break;
+        }
+    }
+  // bucket i holds the samples in (gamma^(index-1), gamma^index]
+  return 2 * std::pow (gamma, m_offset + static_cast<int32_t> (i)) / (gamma + 1);
+}
+
 template <typename T>
 void
 WifiOfdmaExample::Stats<T>::AddSample (T value)
 {
-  m_samples.insert (value);
+  if (m_count == 0 || value < m_min)
+    {
+      m_min = value;
+    }
+  if (m_count == 0 || value > m_max)
+    {
+      m_max = value;
+    }
+  m_count++;
+  m_sum += value;
+  m_sumSquares += double (value) * value;
+  m_sketch.Add (value);
 }
 
 template <typename T>
 void
 WifiOfdmaExample::Stats<T>::RemoveSample (T value)
 {
-  auto it = m_samples.find (value);
-  if (it != m_samples.end ())
+  // min and max are not updated, they may only be wider than the actual range
+  if (m_count > 0 && m_sketch.Remove (value))
     {
-      m_samples.erase (it);
+      m_count--;
+      m_sum -= value;
+      m_sumSquares -= double (value) * value;
     }
 }
 
@@ -625,45 +960,270 @@ template <typename T>
 WifiOfdmaExample::Stats<T>&
 WifiOfdmaExample::Stats<T>::operator+= (const Stats<T>& rhs)
 {
-  this->m_samples.insert (rhs.m_samples.begin (), rhs.m_samples.end ());
+  if (rhs.m_count == 0)
+    {
+      return *this;
+    }
+  m_min = (m_count == 0 ? rhs.m_min : std::min (m_min, rhs.m_min));
+  m_max = (m_count == 0 ? rhs.m_max : std::max (m_max, rhs.m_max));
+  m_count += rhs.m_count;
+  m_sum += rhs.m_sum;
+  m_sumSquares += rhs.m_sumSquares;
+  m_sketch.Merge (rhs.m_sketch);
   return *this;
 }
 
+template <typename T>
+uint64_t
+WifiOfdmaExample::Stats<T>::GetCount () const
+{
+  return m_count;
+}
+
+template <typename T>
+double
+WifiOfdmaExample::Stats<T>::GetSum () const
+{
+  return m_sum;
+}
+
+template <typename T>
+double
+WifiOfdmaExample::Stats<T>::GetMean () const
+{
+  return m_sum / double (m_count);
+}
+
+template <typename T>
+double
+WifiOfdmaExample::Stats<T>::GetStdDev () const
+{
+  double mean = GetMean ();
+  return std::sqrt (std::max (m_sumSquares / double (m_count) - mean * mean, 0.0));
+}
+
+template <typename T>
+double
+WifiOfdmaExample::Stats<T>::GetQuantile (double q) const
+{
+  NS_ASSERT (m_count > 0);
+  if (q <= 0)
+    {
+      return m_min;
+    }
+  if (q >= 1)
+    {
+      return m_max;
+    }
+  auto rank = static_cast<uint64_t> (std::llround (q * (m_count - 1)));
+  return std::min<double> (std::max<double> (m_sketch.GetValueAtRank (rank), m_min), m_max);
+}
+
 template <typename T>
 std::ostream& operator<< (std::ostream& os, const WifiOfdmaExample::Stats<T> &stats)
 {
-//   os << std::fixed << std::setprecision (3)
-//      << "(" << stats.m_min << ", " << stats.m_avg << ", " << stats.m_max << ", " << stats.m_count << ") ";
-  
   os << std::fixed << std::setprecision (3) << "(";
   uint16_t m = WifiOfdmaExample::m_nEcdfSamples - 1;   // number of sub-intervals of [0,1]
-  std::size_t pos = 0, count = stats.m_samples.size ();
-  double sum = 0;
+  uint64_t count = stats.GetCount ();
 
   if (count > 0)
     {
-      for (auto it = stats.m_samples.begin (); it != stats.m_samples.end(); ++it)
+      for (uint16_t i = 0; i <= m; i++)
         {
-          sum += *it;
+          double value = stats.GetQuantile (double (i) / m);
+          if (std::is_integral<T>::value)
+            {
+              os << std::llround (value);
+            }
+          else
+            {
+              os << value;
+            }
+          os << (i < m ? ", " : "");
         }
     }
+  os << ")[" << count << "]"
+     << "<" << stats.GetMean () << ">";
 
-  if (count > 0)
+  os << "sum: "<< stats.GetSum ();
+  return os;
+
+}
+
+uint64_t
+WifiOfdmaExample::DeliveryBitmap::Add ()
+{
+  if (m_count % 64 == 0)
     {
-      auto it = stats.m_samples.begin ();
-      for (uint8_t i = 0; i <= m; i++)
-        {
-          std::advance (it, pos);
-          os << *it << (i < m ? ", " : "");
-          pos = (i + 1) * (count - 1) / m - i * (count - 1) / m;
-        }
+      m_words.push_back (0);
     }
-  os << ")[" << count << "]"
-     << "<" << sum / double (count) << ">";
+  return m_count++;
+}
 
-  os << "sum: "<< sum;
-  return os;
+void
+WifiOfdmaExample::DeliveryBitmap::MarkDelivered (uint64_t seq)
+{
+  NS_ASSERT (seq < m_count);
+  uint64_t mask = uint64_t (1) << (seq % 64);
+  if (!(m_words[seq / 64] & mask))
+    {
+      m_words[seq / 64] |= mask;
+      m_delivered++;
+    }
+}
 
+bool
+WifiOfdmaExample::DeliveryBitmap::IsDelivered (uint64_t seq) const
+{
+  return seq < m_count && (m_words[seq / 64] >> (seq % 64)) & 1;
+}
+
+uint64_t
+WifiOfdmaExample::DeliveryBitmap::GetCount () const
+{
+  return m_count;
+}
+
+uint64_t
+WifiOfdmaExample::DeliveryBitmap::GetDelivered () const
+{
+  return m_delivered;
+}
+
+uint64_t
+WifiOfdmaExample::DeliveryBitmap::GetLost () const
+{
+  return m_count - m_delivered;
+}
+
+void
+WifiOfdmaExample::ThroughputSeries::Start (Time start, Time binWidth, std::size_t capacity)
+{
+  NS_ASSERT (binWidth.IsStrictlyPositive () && capacity > 0);
+  m_start = start;
+  m_binWidth = binWidth;
+  m_bins.assign (capacity, 0);
+  m_currentBin = 0;
+}
+
+void
+WifiOfdmaExample::ThroughputSeries::MoveTo (uint64_t bin)
+{
+  // reset the bins skipped over, which may hold old values once the buffer wrapped
+  for (uint64_t b = m_currentBin + 1; b <= bin && b <= m_currentBin + m_bins.size (); b++)
+    {
+      m_bins[b % m_bins.size ()] = 0;
+    }
+  m_currentBin = std::max (m_currentBin, bin);
+}
+
+void
+WifiOfdmaExample::ThroughputSeries::Add (Time now, uint32_t bytes)
+{
+  if (m_bins.empty () || now < m_start)
+    {
+      return;
+    }
+  uint64_t bin = (now - m_start).GetInteger () / m_binWidth.GetInteger ();
+  MoveTo (bin);
+  m_bins[bin % m_bins.size ()] += bytes;
+}
+
+void
+WifiOfdmaExample::ThroughputSeries::AdvanceTo (Time now)
+{
+  if (!m_bins.empty () && now > m_start)
+    {
+      MoveTo ((now - m_start).GetInteger () / m_binWidth.GetInteger ());
+    }
+}
+
+uint64_t
+WifiOfdmaExample::ThroughputSeries::GetFirstBin () const
+{
+  return m_currentBin < m_bins.size () ? 0 : m_currentBin - m_bins.size () + 1;
+}
+
+uint64_t
+WifiOfdmaExample::ThroughputSeries::GetEndBin () const
+{
+  return m_currentBin;
+}
+
+uint64_t
+WifiOfdmaExample::ThroughputSeries::GetBytes (uint64_t bin) const
+{
+  NS_ASSERT (bin >= GetFirstBin () && bin <= m_currentBin);
+  return m_bins[bin % m_bins.size ()];
+}
+
+Time
+WifiOfdmaExample::ThroughputSeries::GetBinStart (uint64_t bin) const
+{
+  return m_start + m_binWidth * bin;
+}
+
+Time
+WifiOfdmaExample::ThroughputSeries::GetBinWidth () const
+{
+  return m_binWidth;
+}
+
+WifiOfdmaExample::TraceWriter::TraceWriter (std::string filename, std::string header)
+  : m_filename (filename),
+    m_header (header)
+{
+}
+
+WifiOfdmaExample::TraceWriter::~TraceWriter ()
+{
+  Flush ();
+}
+
+template <typename... Args>
+void
+WifiOfdmaExample::TraceWriter::Write (const Args&... columns)
+{
+  if (!m_file.is_open ())
+    {
+      m_file.open (m_filename, std::ios_base::out | std::ios_base::trunc);
+      NS_ABORT_MSG_IF (!m_file.is_open (), "Can't open file " << m_filename);
+      m_buffer.reserve (BUFFER_SIZE);
+      m_buffer += m_header;
+      m_buffer += '\n';
+    }
+  (Append (columns), ...);
+  m_buffer.back () = '\n';
+  if (m_buffer.size () >= BUFFER_SIZE - 256)
+    {
+      Flush ();
+    }
+}
+
+void
+WifiOfdmaExample::TraceWriter::Append (const std::string& column)
+{
+  m_buffer += column;
+  m_buffer += ',';
+}
+
+template <typename T>
+void
+WifiOfdmaExample::TraceWriter::Append (T column)
+{
+  m_buffer += std::to_string (column);
+  m_buffer += ',';
+}
+
+void
+WifiOfdmaExample::TraceWriter::Flush ()
+{
+  if (m_file.is_open () && !m_buffer.empty ())
+    {
+      m_file.write (m_buffer.data (), m_buffer.size ());
+      m_file.flush ();
+      m_buffer.clear ();
+    }
 }
 
 std::ostream &
@@ -677,13 +1237,58 @@ operator<< (std::ostream &os, const WifiOfdmaExample::Flow &flow)
   return os;
 }
 
+template <typename T>
+T&
+WifiOfdmaExample::PerAc<T>::Add (AcIndex ac)
+{
+  NS_ASSERT (static_cast<std::size_t> (ac) < N_ACS);
+  m_present |= (1 << ac);
+  return m_values[ac] = T ();
+}
+
+template <typename T>
+T*
+WifiOfdmaExample::PerAc<T>::Find (AcIndex ac)
+{
+  if (static_cast<std::size_t> (ac) >= N_ACS || !(m_present & (1 << ac)))
+    {
+      return nullptr;
+    }
+  return &m_values[ac];
+}
+
+template <typename T>
+const T*
+WifiOfdmaExample::PerAc<T>::Find (AcIndex ac) const
+{
+  return const_cast<PerAc<T>*> (this)->Find (ac);
+}
+
+template <typename T>
+template <typename FUNC>
+void
+WifiOfdmaExample::PerAc<T>::ForEach (FUNC f)
+{
+  for (std::size_t ac = 0; ac < N_ACS; ac++)
+    {
+      if (m_present & (1 << ac))
+        {
+          f (static_cast<AcIndex> (ac), m_values[ac]);
+        }
+    }
+}
+
 std::size_t
 WifiOfdmaExample::MacAddressHash::operator() (const Mac48Address &address) const
 {
   uint8_t buffer[6];
   address.CopyTo (buffer);
-  std::string s (buffer, buffer + 6);
-  return std::hash<std::string>{}(s);
+  uint64_t value = 0;
+  for (uint8_t byte : buffer)
+    {
+      value = (value << 8) | byte;
+    }
+  return std::hash<uint64_t>{}(value);
 }
 
 std::pair<uint16_t, std::size_t>
@@ -754,12 +1359,31 @@ WifiOfdmaExample::Config (int argc, char *argv[])
   cmd.AddValue ("ackSeqType", "ACK Sequence to employ for DL tx", m_dlAckSeqType);
   cmd.AddValue ("maxTxopDuration", "TXOP duration for BE in microseconds", m_beTxopLimit);
   cmd.AddValue ("simulationTime", "Time to simulate", m_simulationTime);
+  cmd.AddValue ("warmup", "Duration of the warmup period, after traffic starts (seconds)",
+                m_warmup);
+  cmd.AddValue ("assocBatchSize",
+                "Number of stations that associate and set up BA agreements concurrently",
+                m_assocBatchSize);
+  cmd.AddValue ("trafficProfile",
+                "Built-in traffic profile (default, haptic5, haptic8, haptic15) or profile spec",
+                m_trafficProfile);
+  cmd.AddValue ("trafficFile", "File containing the traffic profile (overrides trafficProfile)",
+                m_trafficFile);
+  cmd.AddValue ("tputBinWidth", "Width of the bins of the throughput time series (ms, at least 1)",
+                m_tputBinWidth);
   cmd.AddValue ("m_enableBsrp", "BSRP on or off", m_enableBsrp);
+  cmd.AddValue ("dlScheduler", "DL scheduler logic (rr, bellalta, pf or edf)", m_dlscheduler);
+  cmd.AddValue ("ulScheduler", "UL scheduler logic (rr, bellalta or pf)", m_ulscheduler);
   cmd.Parse (argc, argv);
 
   std::cout << "DL Scheduler " << m_dlscheduler << '\n';
   std::cout << "UL Scheduler " << m_ulscheduler << '\n';
 
+  NS_ABORT_MSG_IF (m_assocBatchSize == 0, "The association batch size must be at least 1");
+  NS_ABORT_MSG_IF (m_warmup < 0, "The warmup period cannot be negative");
+
+  NS_ABORT_MSG_IF (m_tputBinWidth < 1, "The throughput bin width must be at least 1 ms");
+
   // if (m_muBeCwMin == 0)
   //   {
   //     m_muBeAifsn = 0;
@@ -942,574 +1566,188 @@ WifiOfdmaExample::Config (int argc, char *argv[])
   std::cout << std::endl;
 }
 
-void
-WifiOfdmaExample::GenerateTrafficFlows ()
+bool
+WifiOfdmaExample::FlowClass::Matches (uint16_t staId) const
 {
-  uint16_t dstPort = 7000;
-  uint16_t endStaId = m_nStations;
-
-
-  //original code/////
-  bool haptic = false; // 5 device haptic
-
-  bool haptic_new = true; // 15 device haptic
- 
-  bool haptic_10 = false; // 8 device haptic
-
-  if((haptic == false) && (haptic_new == false) && (haptic_10 == false)){
-
-  for (uint16_t staId = 1; staId <= endStaId; staId++)
+  if (m_stations.empty ())
     {
-      if (m_dlTraffic != "None")
-        {
-          Flow flow;
-          flow.m_ac = AC_BE;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = m_frameSize;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 1 * m_dlFlowDataRate * 1e6;
-          flow.m_direction = Flow::DOWNLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          m_flows.push_back (flow);
-
-          // flow.m_ac = AC_VO;
-          // flow.m_l4Proto = Flow::UDP;
-          // flow.m_payloadSize = m_frameSize;
-          // flow.m_stationId = staId;
-          // flow.m_dataRate = 1 * m_dlFlowDataRate * 1e6;
-          // flow.m_direction = Flow::DOWNLINK;
-          // flow.m_dstPort = dstPort++;
-          // NS_LOG_DEBUG ("Adding flow " << flow);
-          // m_flows.push_back (flow);
-
-        }
-      if (m_ulTraffic != "None")
+      return true;
+    }
+  for (const auto &range : m_stations)
+    {
+      if (staId >= range.first && staId <= range.last && (staId - range.first) % range.stride == 0)
         {
-          Flow flow; 
-          // if(staId == 2){
-          // flow.m_ac = AC_VI;
-          // flow.m_l4Proto = Flow::UDP;
-          // flow.m_payloadSize = 1000;
-          // flow.m_stationId = staId;
-          // flow.m_dataRate = 1 * 5 * 1e6;
-          // flow.m_direction = Flow::UPLINK;
-          // flow.m_dstPort = dstPort++;
-          // NS_LOG_DEBUG ("Adding flow " << flow);
-          // m_flows.push_back (flow);
-          // }
-          
-          // if(staId ==1 ) flow.m_ac = AC_BE;
-          // else if(staId == 2) flow.m_ac = AC_BE;
-          // else if(staId == 3) flow.m_ac = AC_BE;
-          // flow.m_l4Proto = Flow::UDP;
-          // flow.m_payloadSize = m_frameSize;
-          // flow.m_stationId = staId;
-          // flow.m_dataRate = 1 * m_ulFlowDataRate * 1e6;
-          // flow.m_direction = Flow::UPLINK;
-          // flow.m_dstPort = dstPort++;
-          // NS_LOG_DEBUG ("Adding flow " << flow);
-          // m_flows.push_back (flow);
-
-          flow.m_ac = AC_BE;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = m_frameSize;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 1 * m_ulFlowDataRate * 1e6;
-          // if(staId == 2){
-          //   flow.m_dataRate = 1 * (m_ulFlowDataRate - 1) * 1e6;  
-          // }
-          // if(staId == 3){
-          //   flow.m_dataRate = 1 * (m_ulFlowDataRate + 1.5) * 1e6;  
-          // }
-          
-          flow.m_direction = Flow::UPLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          m_flows.push_back (flow);
-
-          // if(staId == 1){
-          // flow.m_ac = AC_VO;
-          // flow.m_l4Proto = Flow::UDP;
-          // flow.m_payloadSize = 1;
-          // flow.m_stationId = staId;
-          // flow.m_dataRate = 1 * (m_ulFlowDataRate/2) * 1e3;
-          // flow.m_direction = Flow::UPLINK;
-          // flow.m_dstPort = dstPort++;
-          // NS_LOG_DEBUG ("Adding flow " << flow);
-          // m_flows.push_back (flow);
-          // }
-          
+          return true;
         }
     }
+  return false;
 }
 
-  ///Haptic-model////////////////
-  else if(haptic_new){
+void
+WifiOfdmaExample::ParseTrafficProfile (const std::string &profile)
+{
+  auto toUint = [] (const std::string &value) {
+    std::size_t pos = 0;
+    unsigned long n = 0;
+    try
+      {
+        n = std::stoul (value, &pos);
+      }
+    catch (const std::exception &)
+      {
+        pos = 0;
+      }
+    NS_ABORT_MSG_IF (pos == 0 || pos != value.size (), "Unexpected value " << value);
+    return n;
+  };
 
-    for(uint16_t staId = 1; staId <= endStaId; staId++){
-    Flow flow;
-      if (m_dlTraffic != "None")
+  std::size_t start = 0, end;
+  do
+    {
+      end = profile.find_first_of (";\n", start);
+      std::string line = profile.substr (start, end == std::string::npos ? end : end - start);
+      std::istringstream iss (line.substr (0, line.find ('#')));
+      std::string field;
+      FlowClass flowClass;
+      bool empty = true;
+
+      while (iss >> field)
         {
-          
-          if(staId == 1 || staId == 2 || staId == 3 || staId == 4){ // Video call DL                                                      
-          flow.m_ac = AC_VI;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 1500;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 3 * 1 * 1e6;
-          flow.m_direction = Flow::DOWNLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }
-          else if(staId == 5 || staId == 6 || staId == 7 || staId == 8){ // Audio call DL
-          flow.m_ac = AC_VO;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 160;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate =  64 * 1e3;
-          flow.m_direction = Flow::DOWNLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }
-          else if(staId == 9 || staId == 10 || staId == 11 || staId == 12){ // Video streaming DL
-          flow.m_ac = AC_BE;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 1500;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 1 * 8 * 1e6;
-          flow.m_direction = Flow::DOWNLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }
-          else if(staId == 13 || staId == 14){ // file download DL
-          flow.m_ac = AC_BE;
-          flow.m_l4Proto = Flow::TCP;
-          flow.m_payloadSize = 1500;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 8 * 1 * 1e6;
-          flow.m_direction = Flow::DOWNLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }
-          else if(staId == 15){ // haptic control DL
-          flow.m_ac = AC_VO;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 64;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate =  512*1e3; 
-          flow.m_direction = Flow::DOWNLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }
-          
+          empty = false;
+          std::size_t eq = field.find ('=');
+          NS_ABORT_MSG_IF (eq == std::string::npos, "Expected key=value, found " << field);
+          std::string key = field.substr (0, eq);
+          std::string value = field.substr (eq + 1);
+
+          if (key == "sta")
+            {
+              if (value == "all")
+                {
+                  flowClass.m_stations.clear ();
+                  continue;
+                }
+              std::istringstream items (value);
+              std::string item;
+              while (std::getline (items, item, ','))
+                {
+                  FlowClass::StationRange range {0, 0, 1};
+                  std::size_t slash = item.find ('/');
+                  if (slash != std::string::npos)
+                    {
+                      range.stride = toUint (item.substr (slash + 1));
+                      item.erase (slash);
+                    }
+                  std::size_t dash = item.find ('-');
+                  range.first = toUint (item.substr (0, dash));
+                  range.last = (dash == std::string::npos ? range.first
+                                : dash + 1 == item.size () ? UINT16_MAX
+                                : toUint (item.substr (dash + 1)));
+                  NS_ABORT_MSG_IF (range.first == 0 || range.last < range.first || range.stride == 0,
+                                   "Invalid station selector " << value);
+                  flowClass.m_stations.push_back (range);
+                }
+            }
+          else if (key == "dir")
+            {
+              NS_ABORT_MSG_IF (value != "dl" && value != "ul" && value != "both",
+                               "Invalid direction " << value);
+              flowClass.m_dl = (value != "ul");
+              flowClass.m_ul = (value != "dl");
+            }
+          else if (key == "ac")
+            {
+              auto it = std::find_if (m_aciToString.begin (), m_aciToString.end (),
+                                      [&value] (const auto &aci) { return aci.second == value; });
+              NS_ABORT_MSG_IF (it == m_aciToString.end (), "Invalid AC " << value);
+              flowClass.m_ac = it->first;
+            }
+          else if (key == "l4")
+            {
+              NS_ABORT_MSG_IF (value != "udp" && value != "tcp", "Invalid L4 protocol " << value);
+              flowClass.m_l4Proto = (value == "tcp" ? Flow::TCP : Flow::UDP);
+            }
+          else if (key == "payload")
+            {
+              flowClass.m_payloadSize = toUint (value);
+            }
+          else if (key == "rate")
+            {
+              flowClass.m_dataRate = DataRate (value).GetBitRate ();
+            }
+          else
+            {
+              NS_ABORT_MSG ("Unknown traffic profile field " << key);
+            }
+        }
 
-          }
-        
-      if (m_ulTraffic != "None")
+      if (!empty)
         {
-          // Ptr<UniformRandomVariable> rate_random;
-          // rate_random = CreateObjectWithAttributes<UniformRandomVariable> ("Min", DoubleValue (0.0), "Max",
-          //
-          if(staId == 1 || staId == 2 || staId == 3 || staId == 4){ // video call UL                                                          
-          flow.m_ac = AC_VI;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 1500;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 3 * 1 * 1e6;
-          flow.m_direction = Flow::UPLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-        //   std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }else if(staId == 5 || staId == 6 || staId == 7 || staId == 8){ // audio call UL
-          flow.m_ac = AC_VO;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize =  160;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate =  64 * 1e3;
-          flow.m_direction = Flow::UPLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-        //   std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }else if(staId == 15){ // Haptic UL(Audio, video and pos)
-          flow.m_ac = AC_VO; //haptic flow 
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 64;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 64*8*1e3;
-          flow.m_direction = Flow::UPLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          //   std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-
-          /////////////////
-
-          flow.m_ac = AC_VI; // video 
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 1500;//assuming 30fps
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 4 * 1 * 1e6;
-          flow.m_direction = Flow::UPLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          //   std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-
-          // //////////////////
-
-          }
-          
+          m_flowClasses.push_back (flowClass);
         }
+      start = end + 1;
     }
+  while (end != std::string::npos);
+}
 
+void
+WifiOfdmaExample::GenerateTrafficFlows ()
+{
+  uint16_t dstPort = 7000;
 
-  }
-  else if(haptic_10)
-  {
-  
-  for (uint16_t staId = 1; staId <= endStaId; staId++)
+  if (!m_trafficFile.empty ())
     {
-      Flow flow;
-      if (m_dlTraffic != "None")
-        {
-          
-          if(staId == 1 || staId == 2){ // Video call DL                                                      
-          flow.m_ac = AC_VI;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 1500;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 3 * 1 * 1e6;
-          flow.m_direction = Flow::DOWNLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }
-          else if(staId == 3 || staId == 4){ // Audio call DL
-          flow.m_ac = AC_VO;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 160;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate =  64 * 1e3;
-          flow.m_direction = Flow::DOWNLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }
-          else if(staId == 5 || staId == 6){ // Video streaming DL
-          flow.m_ac = AC_BE;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 1500;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 1 * 8 * 1e6;
-          flow.m_direction = Flow::DOWNLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }
-          else if(staId == 7){ // file download DL
-          flow.m_ac = AC_BE;
-          flow.m_l4Proto = Flow::TCP;
-          flow.m_payloadSize = 1500;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 8 * 1 * 1e6;
-          flow.m_direction = Flow::DOWNLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }
-          else if(staId == 8){ // haptic control DL
-          flow.m_ac = AC_VO;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 64;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate =  512*1e3; 
-          flow.m_direction = Flow::DOWNLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }
-          
-          }
-        
-      if (m_ulTraffic != "None")
-        {
-          // Ptr<UniformRandomVariable> rate_random;
-          // rate_random = CreateObjectWithAttributes<UniformRandomVariable> ("Min", DoubleValue (0.0), "Max",
-          //
-          if(staId == 1 || staId == 2){ // video call UL                                                          
-          flow.m_ac = AC_VI;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 1500;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 3 * 1 * 1e6;
-          flow.m_direction = Flow::UPLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-        //   std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }else if(staId == 3 || staId == 4){ // audio call UL
-          flow.m_ac = AC_VO;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize =  160;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate =  64 * 1e3;
-          flow.m_direction = Flow::UPLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-        //   std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }else if(staId == 8){ // Haptic UL(Audio, video and pos)
-          flow.m_ac = AC_VO; //haptic flow 
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 64;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 64*8*1e3;
-          flow.m_direction = Flow::UPLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          //   std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-
-          /////////////////
-
-          flow.m_ac = AC_VI; // video 
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 1500;//assuming 30fps
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 4 * 1 * 1e6;
-          flow.m_direction = Flow::UPLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          //   std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-
-          // //////////////////
-
-          // flow.m_ac = AC_VO; //audio
-          // flow.m_l4Proto = Flow::UDP;
-          // flow.m_payloadSize = 160;
-          // // flow.m_payloadSize = 2500;
-          // flow.m_stationId = staId;
-          // flow.m_dataRate = 64 * 1e3;
-          // flow.m_direction = Flow::UPLINK;
-          // flow.m_dstPort = dstPort++;
-          // NS_LOG_DEBUG ("Adding flow " << flow);
-          // //   std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          // m_flows.push_back (flow);
-          }
-        }
-          
-        }
-    }else if(haptic){
-      {
-  
-  for (uint16_t staId = 1; staId <= endStaId; staId++)
+      std::ifstream file (m_trafficFile);
+      NS_ABORT_MSG_IF (!file.is_open (), "Can't open traffic file " << m_trafficFile);
+      std::stringstream ss;
+      ss << file.rdbuf ();
+      ParseTrafficProfile (ss.str ());
+    }
+  else
     {
-      Flow flow;
-      if (m_dlTraffic != "None")
-        {
-          
-          if(staId == 1){ // Video call DL                                                      
-          flow.m_ac = AC_VI;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 1500;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 3 * 1 * 1e6;
-          flow.m_direction = Flow::DOWNLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }
-          else if(staId == 2){ // Audio call DL
-          flow.m_ac = AC_VO;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 160;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate =  64 * 1e3;
-          flow.m_direction = Flow::DOWNLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }
-          else if(staId == 3){ // Video streaming DL
-          flow.m_ac = AC_BE;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 1500;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 1 * 8 * 1e6;
-          flow.m_direction = Flow::DOWNLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }
-          else if(staId == 4){ // file download DL
-          flow.m_ac = AC_BE;
-          flow.m_l4Proto = Flow::TCP;
-          flow.m_payloadSize = 1500;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 8 * 1 * 1e6;
-          flow.m_direction = Flow::DOWNLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }
-          else if(staId == 5){ // haptic control DL
-          flow.m_ac = AC_VO;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 64;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate =  512*1e3; 
-          flow.m_direction = Flow::DOWNLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }
-          
-          }
-        
-      if (m_ulTraffic != "None")
+      auto it = m_trafficProfiles.find (m_trafficProfile);
+      ParseTrafficProfile (it != m_trafficProfiles.end () ? it->second : m_trafficProfile);
+    }
+
+  // flows (and their ports) are numbered station by station, downlink flows first
+  for (uint16_t staId = 1; staId <= m_nStations; staId++)
+    {
+      for (auto direction : {Flow::DOWNLINK, Flow::UPLINK})
         {
-          // Ptr<UniformRandomVariable> rate_random;
-          // rate_random = CreateObjectWithAttributes<UniformRandomVariable> ("Min", DoubleValue (0.0), "Max",
-          //
-          if(staId == 1){ // video call UL                                                          
-          flow.m_ac = AC_VI;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 1500;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 3 * 1 * 1e6;
-          flow.m_direction = Flow::UPLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-        //   std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }else if(staId == 2){ // audio call UL
-          flow.m_ac = AC_VO;
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize =  160;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate =  64 * 1e3;
-          flow.m_direction = Flow::UPLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-        //   std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-          }else if(staId == 5){ // Haptic UL(Audio, video and pos)
-          flow.m_ac = AC_VO; //haptic flow 
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 64;
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 64*8*1e3;
-          flow.m_direction = Flow::UPLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          //   std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-
-          /////////////////
-
-          flow.m_ac = AC_VI; // video 
-          flow.m_l4Proto = Flow::UDP;
-          flow.m_payloadSize = 1500;//assuming 30fps
-          // flow.m_payloadSize = 2500;
-          flow.m_stationId = staId;
-          flow.m_dataRate = 4 * 1 * 1e6;
-          flow.m_direction = Flow::UPLINK;
-          flow.m_dstPort = dstPort++;
-          NS_LOG_DEBUG ("Adding flow " << flow);
-          //   std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          m_flows.push_back (flow);
-
-          // //////////////////
-
-          // flow.m_ac = AC_VO; //audio
-          // flow.m_l4Proto = Flow::UDP;
-          // flow.m_payloadSize = 160;
-          // // flow.m_payloadSize = 2500;
-          // flow.m_stationId = staId;
-          // flow.m_dataRate = 64 * 1e3;
-          // flow.m_direction = Flow::UPLINK;
-          // flow.m_dstPort = dstPort++;
-          // NS_LOG_DEBUG ("Adding flow " << flow);
-          // //   std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Adding flow " << flow << '\n';
-          // m_flows.push_back (flow);
-          }
-        }
-          
+          bool dl = (direction == Flow::DOWNLINK);
+          if ((dl ? m_dlTraffic : m_ulTraffic) == "None")
+            {
+              continue;
+            }
+
+          for (const auto &flowClass : m_flowClasses)
+            {
+              if (!(dl ? flowClass.m_dl : flowClass.m_ul) || !flowClass.Matches (staId))
+                {
+                  continue;
+                }
+              Flow flow;
+              flow.m_ac = flowClass.m_ac;
+              flow.m_l4Proto = flowClass.m_l4Proto;
+              flow.m_payloadSize = (flowClass.m_payloadSize > 0 ? flowClass.m_payloadSize
+                                                                : m_frameSize);
+              flow.m_stationId = staId;
+              flow.m_dataRate = (flowClass.m_dataRate > 0 ? flowClass.m_dataRate
+                                 : (dl ? m_dlFlowDataRate : m_ulFlowDataRate) * 1e6);
+              flow.m_direction = direction;
+              flow.m_dstPort = dstPort++;
+              NS_LOG_DEBUG ("Adding flow " << flow);
+              m_flows.push_back (flow);
+            }
         }
     }
-    }
-    }
-    
-
+}
 
 void
 WifiOfdmaExample::NotifyCwChange (uint32_t oldCw, uint32_t newCw)
 {
   NS_LOG_FUNCTION ("Call to NotifyCwChange" << unsigned (oldCw) << unsigned (newCw));
 
-  std::string filename = "CwLog.txt";
-  std::ofstream outFile;
-  outFile.open (filename.c_str (), std::ios_base::out | std::ios_base::app);
-  if (!outFile.is_open ())
-    {
-      NS_LOG_ERROR ("Can't open file " << filename);
-      return;
-    }
-
-  uint32_t c = Simulator::GetContext ();
-
-  outFile << Simulator::Now ().GetSeconds () << " " << unsigned (c) << " " << unsigned (oldCw)
-          << " " << unsigned (newCw) << std::endl;
+  m_cwLog.Write (Simulator::Now ().GetNanoSeconds (), Simulator::GetContext (), oldCw, newCw);
 }
 
 void
@@ -1517,40 +1755,27 @@ WifiOfdmaExample::NotifyBackoffChange (uint32_t backoff)
 {
   NS_LOG_FUNCTION ("Call to NotifyBackoffChange" << unsigned(backoff));
 
-  std::string filename = "BackoffLog.txt";
-  std::ofstream outFile;
-  outFile.open (filename.c_str (), std::ios_base::out | std::ios_base::app);
-  if (!outFile.is_open ())
-    {
-      NS_LOG_ERROR ("Can't open file " << filename);
-      return;
-    }
-
-  uint32_t c = Simulator::GetContext();
-
-  outFile << Simulator::Now ().GetSeconds () << " " << unsigned (c) << " " << unsigned (backoff)
-          << std::endl;
+  m_backoffLog.Write (Simulator::Now ().GetNanoSeconds (), Simulator::GetContext (), backoff);
 }
 
 void
-WifiOfdmaExample::NotifyStateChange (std::string context, Time oldt, Time duration,
+WifiOfdmaExample::NotifyStateChange (uint32_t nodeId, Time oldt, Time duration,
                                      WifiPhyState newState)
 {
-  NS_LOG_FUNCTION ("Call to NotifyStateChange" << context << oldt << duration << newState);
+  NS_LOG_FUNCTION ("Call to NotifyStateChange" << nodeId << oldt << duration << newState);
 
-  std::string filename = "WifiPhyStateLog.txt";
-  std::ofstream outFile;
-  outFile.open (filename.c_str (), std::ios_base::out | std::ios_base::app);
-  if (!outFile.is_open ())
+  // the names of the states are only formatted once
+  static std::map<WifiPhyState, std::string> stateNames;
+  auto it = stateNames.find (newState);
+  if (it == stateNames.end ())
     {
-      NS_LOG_ERROR ("Can't open file " << filename);
-      return;
+      std::ostringstream oss;
+      oss << newState;
+      it = stateNames.emplace (newState, oss.str ()).first;
     }
 
-  uint32_t c = ContextToNodeId (context);
-
-  outFile << Simulator::Now ().GetSeconds () << " " << c << " " << oldt.GetMicroSeconds () << " "
-          << duration.GetMicroSeconds () << " " << newState << std::endl;
+  m_phyStateLog.Write (Simulator::Now ().GetNanoSeconds (), nodeId,
+                       oldt.GetMicroSeconds (), duration.GetMicroSeconds (), it->second);
 }
 
 void
@@ -1730,6 +1955,18 @@ WifiOfdmaExample::Setup (void)
             {
               m_dlschedulerLogic = "Bellalta";
             }
+          else if (m_dlscheduler == "pf")
+            {
+              m_dlschedulerLogic = "PropFair";
+            }
+          else if (m_dlscheduler == "edf")
+            {
+              m_dlschedulerLogic = "Edf";
+            }
+          else
+            {
+              NS_ABORT_MSG ("Unrecognized DL scheduler: " << m_dlscheduler);
+            }
           if (m_ulscheduler == "rr")
             {
               m_ulschedulerLogic = "Standard";
@@ -1738,6 +1975,14 @@ WifiOfdmaExample::Setup (void)
             {
               m_ulschedulerLogic = "Bellalta";
             }
+          else if (m_ulscheduler == "pf")
+            {
+              m_ulschedulerLogic = "PropFair";
+            }
+          else
+            {
+              NS_ABORT_MSG ("Unrecognized UL scheduler: " << m_ulscheduler);
+            }
           std::string bw = std::to_string(m_channelWidth);
 
           mac.SetMultiUserScheduler ("ns3::RrMultiUserScheduler",
@@ -2082,36 +2327,51 @@ WifiOfdmaExample::Setup (void)
         {
           if (flow.m_direction == Flow::DOWNLINK)
             {
-              m_dlPerStaAcStats[flow.m_stationId - 1][flow.m_ac] = PairwisePerAcStats ();
-              m_perAcStats[0][flow.m_ac] = PerAcStats ();
+              m_dlPerStaAcStats[flow.m_stationId - 1].Add (flow.m_ac);
+              m_perAcStats[0].Add (flow.m_ac);
             }
           else
             {
               // TCP uplink flow -> BE downlink flow comprising TCP acks
-              m_dlPerStaAcStats[flow.m_stationId - 1][AC_BE] = PairwisePerAcStats ();
-              m_perAcStats[0][AC_BE] = PerAcStats ();
+              m_dlPerStaAcStats[flow.m_stationId - 1].Add (AC_BE);
+              m_perAcStats[0].Add (AC_BE);
             }
         }
       if (flow.m_direction == Flow::UPLINK || flow.m_l4Proto == Flow::TCP)
         {
           if (flow.m_direction == Flow::UPLINK)
             {
-              m_ulPerStaAcStats[flow.m_stationId - 1][flow.m_ac] = PairwisePerAcStats ();
-              m_perAcStats[flow.m_stationId][flow.m_ac] = PerAcStats ();
+              m_ulPerStaAcStats[flow.m_stationId - 1].Add (flow.m_ac);
+              m_perAcStats[flow.m_stationId].Add (flow.m_ac);
             }
           else
             {
               // TCP downlink flow -> BE uplink flow comprising TCP acks
-              m_ulPerStaAcStats[flow.m_stationId - 1][AC_BE] = PairwisePerAcStats ();
-              m_perAcStats[flow.m_stationId][AC_BE] = PerAcStats ();
+              m_ulPerStaAcStats[flow.m_stationId - 1].Add (AC_BE);
+              m_perAcStats[flow.m_stationId].Add (AC_BE);
             }
         }
     }
 
-  Config::ConnectWithoutContext ("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Mac/$ns3::StaWifiMac/Assoc",
-                                 MakeCallback (&WifiOfdmaExample::EstablishBaAgreement, this));
+  // station indices are bound to the callbacks, OBSS stations following the
+  // stations of the BSS under test
+  uint16_t sta = 0;
+  auto connectAssoc = [this, &sta] (const NetDeviceContainer &devices) {
+    for (auto it = devices.Begin (); it != devices.End (); it++)
+      {
+        DynamicCast<WifiNetDevice> (*it)->GetMac ()->TraceConnectWithoutContext (
+            "Assoc", MakeCallback (&WifiOfdmaExample::EstablishBaAgreement, this).Bind (sta++));
+      }
+  };
+  connectAssoc (m_staDevices);
+  for (const auto &devices : m_obssStaDevices)
+    {
+      connectAssoc (devices);
+    }
+  m_staSetUp.assign (sta, false);
 
   // populate m_staMacAddressToNodeId map
+  m_apAddress = Mac48Address::ConvertFrom (m_apDevices.Get (0)->GetAddress ());
   for (auto it = m_staDevices.Begin (); it != m_staDevices.End (); it++)
     {
       m_staMacAddressToNodeId[Mac48Address::ConvertFrom ((*it)->GetAddress ())] =
@@ -2133,19 +2393,18 @@ WifiOfdmaExample::Run (void)
 
 template <typename T, typename FUNC>
 void
-WifiOfdmaExample::PrintStatsWithTotal (std::vector<std::map<AcIndex, T>> v, FUNC select,
+WifiOfdmaExample::PrintStatsWithTotal (const std::vector<PerAc<T>> &v, FUNC select,
                                        std::ostream &os, std::string s, std::string s0)
 {
   std::size_t i;
   auto ac = m_aciToString.begin ();
   decltype (select (std::declval<T> ())) sum{0}, totalSum{0}, ap{0};
 
-  auto print = [&] (const std::map<AcIndex, T> &x, std::string str = "") {
-    auto it = x.find (ac->first);
-    if (it != x.end ())
+  auto print = [&] (const PerAc<T> &x, std::string str = "") {
+    if (auto value = x.Find (ac->first))
       {
-        os << (str.empty () ? s + std::to_string (i) : s0) << ": " << select (it->second) << " ";
-        sum += select (it->second);
+        os << (str.empty () ? s + std::to_string (i) : s0) << ": " << select (*value) << " ";
+        sum += select (*value);
       }
     i++;
   };
@@ -2154,8 +2413,8 @@ WifiOfdmaExample::PrintStatsWithTotal (std::vector<std::map<AcIndex, T>> v, FUNC
   for (; ac != m_aciToString.end (); ac++)
     {
       // check if at least one station exchanged traffic of this AC
-      if (std::find_if (v.begin (), v.end (), [&ac] (const std::map<AcIndex, T> &map) {
-            return map.find (ac->first) != map.end ();
+      if (std::find_if (v.begin (), v.end (), [&ac] (const PerAc<T> &x) {
+            return x.Find (ac->first) != nullptr;
           }) == v.end ())
         {
           continue;
@@ -2193,17 +2452,16 @@ WifiOfdmaExample::PrintStatsWithTotal (std::vector<std::map<AcIndex, T>> v, FUNC
 
 template <typename T, typename FUNC>
 void
-WifiOfdmaExample::PrintStats (std::vector<std::map<AcIndex, T>> v, FUNC select, std::ostream &os,
+WifiOfdmaExample::PrintStats (const std::vector<PerAc<T>> &v, FUNC select, std::ostream &os,
                               std::string s, std::string s0)
 {
   std::size_t i;
   auto ac = m_aciToString.begin ();
 
-  auto print = [&] (const std::map<AcIndex, T> &x, std::string str = "") {
-    auto it = x.find (ac->first);
-    if (it != x.end ())
+  auto print = [&] (const PerAc<T> &x, std::string str = "") {
+    if (auto value = x.Find (ac->first))
       {
-        os << (str.empty () ? s + std::to_string (i) : s0) << ": " << select (it->second) << " ";
+        os << (str.empty () ? s + std::to_string (i) : s0) << ": " << select (*value) << " ";
       }
     i++;
   };
@@ -2212,8 +2470,8 @@ WifiOfdmaExample::PrintStats (std::vector<std::map<AcIndex, T>> v, FUNC select,
   for (; ac != m_aciToString.end (); ac++)
     {
       // check if at least one station exchanged traffic of this AC
-      if (std::find_if (v.begin (), v.end (), [&ac] (const std::map<AcIndex, T> &map) {
-            return map.find (ac->first) != map.end ();
+      if (std::find_if (v.begin (), v.end (), [&ac] (const PerAc<T> &x) {
+            return x.Find (ac->first) != nullptr;
           }) == v.end ())
         {
           continue;
@@ -2354,11 +2612,15 @@ uint64_t rx_bytes_mac = 0;
 
     // os << "Total dropped bytes at App(DL + UL): " << (tx_bytes_app_dl - rx_bytes_app_dl) + (tx_bytes_app_ul - rx_bytes_app_ul)<< '\n';
     os << "Total dropped bytes at MAC(DL + UL): " << tx_bytes_mac - rx_bytes_mac << '\n';
-  for(auto thru:Throughputs){
-os << "Throughput per 1000 packets " << thru << '\n';
-
-    
-  }
+  os << "Per-AC throughput over " << m_tputBinWidth << " ms bins (Mbps)" << '\n';
+  for (auto &acStats : m_dlTputSeries)
+    {
+      os << "DL [" << m_aciToString.at (acStats.first) << "] " << acStats.second << '\n';
+    }
+  for (auto &acStats : m_ulTputSeries)
+    {
+      os << "UL [" << m_aciToString.at (acStats.first) << "] " << acStats.second << '\n';
+    }
 
   // for (auto temp:tcptime){
 
@@ -2387,20 +2649,9 @@ WifiOfdmaExample::PrintResults (std::ostream &os)
         
     for (std::size_t i = 0; i < m_flows.size (); i++)
     {
-        double avglat = 0;
-        size_t count = 0;
-        double stdeviation = 0;
-        count = m_flows[i].m_latency.m_samples.size();
-        for (auto it = m_flows[i].m_latency.m_samples.begin (); it != m_flows[i].m_latency.m_samples.end(); ++it)
-        {
-          avglat += *it;
-        }
-        double latmean = avglat/double(count);
-        for (auto it = m_flows[i].m_latency.m_samples.begin (); it != m_flows[i].m_latency.m_samples.end(); ++it)
-        {
-          stdeviation += ((*it-latmean)*(*it-latmean));
-        }
-        stdeviation = sqrt(stdeviation/double(count));
+        size_t count = m_flows[i].m_latency.GetCount ();
+        double avglat = m_flows[i].m_latency.GetSum ();
+        double stdeviation = m_flows[i].m_latency.GetStdDev ();
         
 
       os << "FLOW " << m_flows[i] << std::endl;
@@ -2473,19 +2724,9 @@ WifiOfdmaExample::PrintResults (std::ostream &os)
       if(m_flows[i].m_direction == Flow::UPLINK && m_flows[i].m_l4Proto == Flow::UDP) ul_size++;
 
         
-        double avglat = 0;
-        double stdeviation = 0;
-        double count = m_flows[i].m_latency.m_samples.size();
-        for (auto it = m_flows[i].m_latency.m_samples.begin (); it != m_flows[i].m_latency.m_samples.end(); ++it)
-        {
-          avglat += *it;
-        }
-        double latmean = avglat/double(count);
-        for (auto it = m_flows[i].m_latency.m_samples.begin (); it != m_flows[i].m_latency.m_samples.end(); ++it)
-        {
-          stdeviation += ((*it-latmean)*(*it-latmean));
-        }
-        stdeviation = sqrt(stdeviation/double(count));
+        double count = m_flows[i].m_latency.GetCount ();
+        double avglat = m_flows[i].m_latency.GetSum ();
+        double stdeviation = m_flows[i].m_latency.GetStdDev ();
       
 
       os << "FLOW " << m_flows[i] << std::endl;
@@ -2570,16 +2811,22 @@ WifiOfdmaExample::PrintResults (std::ostream &os)
     }
 
   /* Per-AC statistics from per-flow statistics */
-  std::vector<std::map<AcIndex, double>> dlTput (m_nStations), ulTput (m_nStations);
-  std::vector<std::map<AcIndex, Stats<double>>> dlLatency (m_nStations), ulLatency (m_nStations);
-  std::vector<std::map<AcIndex, uint64_t>> dlSentPkts (m_nStations), ulSentPkts (m_nStations),
+  std::vector<PerAc<double>> dlTput (m_nStations), ulTput (m_nStations);
+  std::vector<PerAc<Stats<double>>> dlLatency (m_nStations), ulLatency (m_nStations);
+  std::vector<PerAc<uint64_t>> dlSentPkts (m_nStations), ulSentPkts (m_nStations),
       dlRecvPkts (m_nStations), ulRecvPkts (m_nStations);
 
+  // return the slot of the given AC, adding it if not present
+  auto getOrAdd = [] (auto &perAc, AcIndex ac) -> auto & {
+    auto value = perAc.Find (ac);
+    return (value != nullptr ? *value : perAc.Add (ac));
+  };
+
   for (std::size_t i = 0; i < m_flows.size (); i++)
     {
-      std::vector<std::map<AcIndex, double>>::iterator tputVecIt;
-      std::vector<std::map<AcIndex, Stats<double>>>::iterator latencyVecIt;
-      std::vector<std::map<AcIndex, uint64_t>>::iterator sentVecIt, recvVecIt;
+      std::vector<PerAc<double>>::iterator tputVecIt;
+      std::vector<PerAc<Stats<double>>>::iterator latencyVecIt;
+      std::vector<PerAc<uint64_t>>::iterator sentVecIt, recvVecIt;
 
       if (m_flows[i].m_direction == Flow::DOWNLINK)
         {
@@ -2596,17 +2843,11 @@ WifiOfdmaExample::PrintResults (std::ostream &os)
           recvVecIt = std::next (ulRecvPkts.begin (), m_flows[i].m_stationId - 1);
         }
 
-      auto mapIt = tputVecIt->insert ({m_flows[i].m_ac, 0.0}).first;
-      mapIt->second += (m_flows[i].m_rxBytes * 8.) / (m_simulationTime * 1e6);
-
-      auto mapIt2 = latencyVecIt->insert ({m_flows[i].m_ac, 0}).first;
-      mapIt2->second += m_flows[i].m_latency;
-
-      auto mapIt3 = sentVecIt->insert ({m_flows[i].m_ac, 0.0}).first;
-      mapIt3->second += (m_flows[i].m_txPackets + m_flows[i].m_packetsRejectedBySocket);
-
-      mapIt3 = recvVecIt->insert ({m_flows[i].m_ac, 0.0}).first;
-      mapIt3->second += m_flows[i].m_rxPackets;
+      getOrAdd (*tputVecIt, m_flows[i].m_ac) += (m_flows[i].m_rxBytes * 8.) / (m_simulationTime * 1e6);
+      getOrAdd (*latencyVecIt, m_flows[i].m_ac) += m_flows[i].m_latency;
+      getOrAdd (*sentVecIt, m_flows[i].m_ac) +=
+          (m_flows[i].m_txPackets + m_flows[i].m_packetsRejectedBySocket);
+      getOrAdd (*recvVecIt, m_flows[i].m_ac) += m_flows[i].m_rxPackets;
     }
 
   os << "PAIRWISE PER-AC statistics" << std::endl << "************************" << std::endl;
@@ -2745,10 +2986,9 @@ WifiOfdmaExample::PrintResults (std::ostream &os)
   for (uint16_t i = 0; i < m_nStations; i++)
     {
       uint64_t heTbPPduCount = 0; // for i-th STA
-      for (auto &acStats : m_ulPerStaAcStats.at (i))
-        {
-          heTbPPduCount += acStats.second.ampduRatio.m_samples.size ();
-        }
+      m_ulPerStaAcStats.at (i).ForEach ([&heTbPPduCount] (AcIndex, PairwisePerAcStats &stats) {
+        heTbPPduCount += stats.ampduRatio.GetCount ();
+      });
       os << "STA_" << i + 1 << ": "
          << static_cast<double> (m_nSolicitingBasicTriggerFrames.at (i) - heTbPPduCount) /
                 m_nSolicitingBasicTriggerFrames.at (i)
@@ -2756,42 +2996,73 @@ WifiOfdmaExample::PrintResults (std::ostream &os)
     }
   os << std::endl << std::endl;
     }
+
+  os << "MU scheduler statistics" << std::endl << "************************" << std::endl;
+  for (const auto& [ap, metrics] : m_muSchedulerMetrics)
+    {
+      os << std::fixed << std::setprecision (3)
+         << "AP_" << ap << ": BSRP TFs: " << metrics.nBsrpTfs
+         << " (" << metrics.bsrpTime.GetMicroSeconds () << " us)"
+         << " Basic TFs: " << metrics.nBasicTfs
+         << " (" << metrics.basicTime.GetMicroSeconds () << " us)"
+         << " DL MU PPDUs: " << metrics.nDlMuPpdus << std::endl
+         << "AP_" << ap << ": UL time granted: " << metrics.ulTime.GetMicroSeconds () << " us"
+         << " (" << metrics.ulTime.GetSeconds () / m_simulationTime * 100 << "% of airtime)"
+         << std::endl;
+      m_muSchedulerLog.Write (ap, metrics.nBsrpTfs, metrics.nBasicTfs, metrics.nDlMuPpdus,
+                              metrics.bsrpTime.GetMicroSeconds (),
+                              metrics.basicTime.GetMicroSeconds (),
+                              metrics.ulTime.GetMicroSeconds ());
+    }
+  m_muSchedulerLog.Flush ();
+  os << std::endl;
 }
 
 void
 WifiOfdmaExample::StartAssociation (void)
 {
-//   std::cout << "At time "<<Simulator::Now().GetMicroSeconds () <<" Calling Start Association function"<< '\n';
   NS_LOG_FUNCTION (this << m_currentSta);
-  NS_ASSERT (m_currentSta < m_nStations + m_nObss * m_nStationsPerObss);
+  uint16_t nTotalStations = m_nStations + m_nObss * m_nStationsPerObss;
+  NS_ASSERT (m_currentSta < nTotalStations);
 
-  Ptr<WifiNetDevice> dev;
-  uint16_t bss = 0;
+  m_pendingAssoc = std::min<uint16_t> (m_assocBatchSize, nTotalStations - m_currentSta);
 
-  if (m_currentSta < m_nStations)
-    {
-      dev = DynamicCast<WifiNetDevice> (m_staDevices.Get (m_currentSta));
-    }
-  else
+  for (uint16_t sta = m_currentSta; sta < m_currentSta + m_pendingAssoc; sta++)
     {
-      auto pair = StationIdToBssIndexPair (m_currentSta);
-      bss = pair.first;
-      dev = DynamicCast<WifiNetDevice> (m_obssStaDevices.at (bss - 1).Get (pair.second));
-    }
+      Ptr<WifiNetDevice> dev;
+      uint16_t bss = 0;
+
+      if (sta < m_nStations)
+        {
+          dev = DynamicCast<WifiNetDevice> (m_staDevices.Get (sta));
+        }
+      else
+        {
+          auto pair = StationIdToBssIndexPair (sta);
+          bss = pair.first;
+          dev = DynamicCast<WifiNetDevice> (m_obssStaDevices.at (bss - 1).Get (pair.second));
+        }
 
-  // NS_ASSERT (dev != 0);
-  // this will lead the station to associate with the AP
-  dev->GetMac ()->SetSsid (Ssid (m_ssidPrefix + std::to_string (bss)));
+      // this will lead the station to associate with the AP
+      dev->GetMac ()->SetSsid (Ssid (m_ssidPrefix + std::to_string (bss)));
+    }
 }
 
 void
-WifiOfdmaExample::EstablishBaAgreement (Mac48Address bssid)
+WifiOfdmaExample::EstablishBaAgreement (uint16_t sta, Mac48Address bssid)
 {
-  NS_LOG_FUNCTION (this << bssid << m_currentSta);
+  NS_LOG_FUNCTION (this << sta << bssid);
+
+  if (m_staSetUp.at (sta))
+    {
+      // the station re-associated after being set up
+      return;
+    }
+  m_staSetUp[sta] = true;
 
 //   std::cout << "At time "<<Simulator::Now() <<" Calling EstablishBaAgreement function"<< '\n';
 
-  // Now that the current station is associated with the AP, let's trigger the creation
+  // Now that the station is associated with the AP, let's trigger the creation
   // of an entry in the ARP cache (of both the AP and the STA) and the establishment of
   // Block Ack agreements between the AP and the STA (and viceversa) for the relevant
   // TIDs. This is done by having the AP send 4 ICMP Echo Requests to the STA
@@ -2809,14 +3080,14 @@ WifiOfdmaExample::EstablishBaAgreement (Mac48Address bssid)
   Ptr<Node> apNode;
   uint16_t bss = 0;
 
-  if (m_currentSta < m_nStations)
+  if (sta < m_nStations)
     {
-      staAddress = m_staInterfaces.GetAddress (m_currentSta);
+      staAddress = m_staInterfaces.GetAddress (sta);
       apNode = m_apNodes.Get (0);
     }
   else
     {
-      auto pair = StationIdToBssIndexPair (m_currentSta);
+      auto pair = StationIdToBssIndexPair (sta);
       bss = pair.first;
       staAddress = m_obssStaInterfaces.at (bss - 1).GetAddress (pair.second);
       apNode = m_apNodes.Get (bss);
@@ -2875,7 +3146,7 @@ std::cout<<"Added ping addresses\n";
       std::string socketType =
               (flow.m_l4Proto == Flow::TCP ? "ns3::TcpSocketFactory" : "ns3::UdpSocketFactory");
           
-      if (flow.m_stationId == m_currentSta + 1)
+      if (flow.m_stationId == sta + 1)
         {
         //   std::cout << "At time "<<Simulator::Now().GetMicroSeconds () << " Installing client application for flow " << i << '\n'; 
           
@@ -2902,13 +3173,13 @@ std::cout<<"Added ping addresses\n";
           Ptr<Node> srcNode;
           if (flow.m_direction == Flow::DOWNLINK)
             {
-              destAddress = m_staInterfaces.GetAddress (m_currentSta);
+              destAddress = m_staInterfaces.GetAddress (sta);
               srcNode = m_apNodes.Get (0);
             }
           else
             {
               destAddress = m_apInterfaces.GetAddress (0);
-              srcNode = m_staNodes.Get (m_currentSta);
+              srcNode = m_staNodes.Get (sta);
             }
           InetSocketAddress dest (destAddress, flow.m_dstPort);
           dest.SetTos (acTos.at (flow.m_ac));
@@ -2950,13 +3221,13 @@ std::cout<<"Added ping addresses\n";
 
           if (flow.m_direction == Flow::DOWNLINK)
             {
-              destAddress = m_staInterfaces.GetAddress (m_currentSta);
+              destAddress = m_staInterfaces.GetAddress (sta);
               srcNode = m_apNodes.Get (0);
             }
           else
             {
               destAddress = m_apInterfaces.GetAddress (0);
-              srcNode = m_staNodes.Get (m_currentSta);
+              srcNode = m_staNodes.Get (sta);
             }
           InetSocketAddress dest (destAddress, flow.m_dstPort);
           dest.SetTos (acTos.at (flow.m_ac));
@@ -2973,7 +3244,7 @@ std::cout<<"Added ping addresses\n";
     }
 std::cout<<"Added all flows\n";
   // Install client applications in the OBSSes
-  if (m_currentSta >= m_nStations && m_obssDlAggregateRate > 0)
+  if (sta >= m_nStations && m_obssDlAggregateRate > 0)
     {
       OnOffHelper client ("ns3::UdpSocketFactory", Ipv4Address::GetAny ());
       client.SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
@@ -2987,7 +3258,7 @@ std::cout<<"Added all flows\n";
                            apNode);
     }
 
-  if (m_currentSta >= m_nStations && m_obssUlAggregateRate > 0)
+  if (sta >= m_nStations && m_obssUlAggregateRate > 0)
     {
       OnOffHelper client ("ns3::UdpSocketFactory", Ipv4Address::GetAny ());
       client.SetAttribute ("OnTime", StringValue ("ns3::ConstantRandomVariable[Constant=0]"));
@@ -2998,14 +3269,26 @@ std::cout<<"Added all flows\n";
       client.SetAttribute ("Remote", AddressValue (InetSocketAddress (m_apInterfaces.GetAddress (bss),
                                                                       7000)));
 
-      auto pair = StationIdToBssIndexPair (m_currentSta);
+      auto pair = StationIdToBssIndexPair (sta);
 
       Simulator::Schedule (startDelay, &WifiOfdmaExample::StartObssClient, this, client, bss,
                            m_obssStaNodes.at (bss - 1).Get (pair.second));
     }
 
-  // continue with the next station, if any is remaining
-  if (++m_currentSta < m_nStations + m_nObss * m_nStationsPerObss)
+  NS_ASSERT (m_pendingAssoc > 0);
+  if (--m_pendingAssoc > 0)
+    {
+      // wait for the other stations of the current batch
+      return;
+    }
+
+  // the clients of the last station of the batch to associate are the last ones
+  // to start, hence the next steps are scheduled relative to their start
+  uint16_t nTotalStations = m_nStations + m_nObss * m_nStationsPerObss;
+  m_currentSta += std::min<uint16_t> (m_assocBatchSize, nTotalStations - m_currentSta);
+
+  // continue with the next batch, if any station is remaining
+  if (m_currentSta < nTotalStations)
     {
       Simulator::Schedule (startDelay + MilliSeconds (pingInterval),
                            &WifiOfdmaExample::StartAssociation, this);
@@ -3014,7 +3297,6 @@ std::cout<<"Added all flows\n";
     {
       // call DelayStart (which changes the duration of the last "Off" period) 1 ms
       // before a slot boundary
-    //   std::cout<<"Finished association and BA Agreement establishment between all stations and AP\n";
       Simulator::Schedule (startDelay + MilliSeconds (pingInterval - 1),
                            &WifiOfdmaExample::DelayStart, this);
     }
@@ -3295,19 +3577,26 @@ WifiOfdmaExample::StartStatistics (void)
   NS_LOG_FUNCTION (this);
 
   std::cout << "Starting statistics at " << Simulator::Now ().GetMicroSeconds() << std::endl;
+  for (auto devIt = m_apDevices.Begin (); devIt != m_apDevices.End (); devIt++)
+    {
+      if (auto scheduler = GetRrMuScheduler (*devIt))
+        {
+          scheduler->ResetMetrics ();
+        }
+    }
   /* Connect traces on all the stations (including the AP) and for all the ACs */
   NetDeviceContainer devices = m_staDevices;
   devices.Add (m_apDevices.Get (0));
 
   if (m_verbose)
     {
-      Config::Connect ("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Phy/State/State",
-                       MakeCallback (&WifiOfdmaExample::NotifyStateChange, this));
+      ConnectPhyStateTraces (true);
     }
 
   for (auto devIt = devices.Begin (); devIt != devices.End (); devIt++)
     {
       Ptr<WifiNetDevice> dev = DynamicCast<WifiNetDevice> (*devIt);
+      uint32_t nodeId = dev->GetNode ()->GetId ();
       Ptr<QosTxop> qosTxop;
 
       for (auto &ac : m_aciToString)
@@ -3318,13 +3607,13 @@ WifiOfdmaExample::StartStatistics (void)
           qosTxop = ptr.Get<QosTxop> ();
           // trace expired MSDUs
           qosTxop->GetWifiMacQueue ()->TraceConnectWithoutContext ("Expired",
-            MakeCallback (&WifiOfdmaExample::NotifyMsduExpired, this));
+            MakeCallback (&WifiOfdmaExample::NotifyMsduExpired, this).Bind (nodeId));
             // std::cout<<"Done1\n";
           // qosTxop->GetBaManager ()->GetRetransmitQueue ()->TraceConnectWithoutContext ("Expired",
           //   MakeCallback (&WifiOfdmaExample::NotifyMsduExpired, this));
           // trace rejected MSDUs
           qosTxop->GetWifiMacQueue ()->TraceConnectWithoutContext ("DropBeforeEnqueue",
-            MakeCallback (&WifiOfdmaExample::NotifyMsduRejected, this));
+            MakeCallback (&WifiOfdmaExample::NotifyMsduRejected, this).Bind (nodeId));
                       // std::cout<<"Done2\n";
 
           // trace packets enqueued in the EDCA queue
@@ -3335,7 +3624,7 @@ WifiOfdmaExample::StartStatistics (void)
           // trace MSDUs dequeued from the EDCA queue
           qosTxop->GetWifiMacQueue ()->TraceConnectWithoutContext ("Dequeue", 
             MakeCallback (&WifiOfdmaExample::NotifyMsduDequeuedFromEdcaQueue, this)
-            .Bind (qosTxop->GetWifiMacQueue ()->GetMaxDelay ()));
+            .Bind (qosTxop->GetWifiMacQueue ()->GetMaxDelay (), nodeId));
             //  std::cout<<"Done4\n";
 
           // trace TXOP duration
@@ -3368,7 +3657,6 @@ std::cout<<"Done\n";
       NS_ABORT_MSG_IF (sink == nullptr, "Not a PacketSink?");
       sink->TraceConnectWithoutContext ("Rx", MakeCallback (&WifiOfdmaExample::NotifyAppRx, this)
                                               .Bind (i));
-      m_flows[i].m_prevRxBytes = sink->GetTotalRx ();
       }else{ // for bulksendtcp
       
       Ptr<BulkSendApplication> sender = DynamicCast<BulkSendApplication> (m_clientApps[i]);
@@ -3381,7 +3669,6 @@ std::cout<<"Done\n";
       NS_ABORT_MSG_IF (sink == nullptr, "Not a PacketSink?");
       sink->TraceConnectWithoutContext ("Rx", MakeCallback (&WifiOfdmaExample::NotifyAppRx, this)
                                               .Bind (i));
-      m_flows[i].m_prevRxBytes = sink->GetTotalRx ();
 
       ///////////////////////////
 
@@ -3395,6 +3682,15 @@ std::cout<<"Done\n";
       }
     }
 
+  // one more bin than needed to cover the simulation time, in case StopStatistics
+  // runs after the end of the last bin
+  Time binWidth = MicroSeconds (static_cast<int64_t> (m_tputBinWidth * 1000));
+  auto nBins = static_cast<std::size_t> (std::ceil (m_simulationTime * 1000 / m_tputBinWidth)) + 1;
+  for (auto &flow : m_flows)
+    {
+      flow.m_tputSeries.Start (Simulator::Now (), binWidth, nBins);
+    }
+
   for (std::size_t i = 0; i <= m_nStations; i++)
     {
       Ptr<Node> node = (i == 0 ? m_apNodes.Get (0) : m_staNodes.Get (i - 1));
@@ -3405,19 +3701,17 @@ std::cout<<"Done\n";
       Ptr<QueueDisc> qdisc = tc->GetRootQueueDiscOnDevice (device);
       if (qdisc != nullptr && qdisc->GetNQueueDiscClasses () == 4)
         {
-          Ptr<QueueDisc> child;
-          for (auto &acStats : m_perAcStats.at (i))
-            {
-              child = qdisc->GetQueueDiscClass (static_cast<std::size_t> (acStats.first))
-                          ->GetQueueDisc ();
-              acStats.second.droppedByQueueDisc = child->GetStats ().nTotalDroppedPackets;
-              child->TraceConnectWithoutContext ("SojournTime",
-                                                 MakeCallback (&WifiOfdmaExample::NotifySojournTime, this)
-                                                 .Bind (i, acStats.first));
-              child->TraceConnectWithoutContext ("DropAfterDequeue",
-                                                 MakeCallback (&WifiOfdmaExample::NotifyDropAfterDequeue, this)
-                                                 .Bind (i, acStats.first));
-            }
+          m_perAcStats.at (i).ForEach ([&] (AcIndex ac, PerAcStats &stats) {
+            Ptr<QueueDisc> child =
+                qdisc->GetQueueDiscClass (static_cast<std::size_t> (ac))->GetQueueDisc ();
+            stats.droppedByQueueDisc = child->GetStats ().nTotalDroppedPackets;
+            child->TraceConnectWithoutContext ("SojournTime",
+                                               MakeCallback (&WifiOfdmaExample::NotifySojournTime, this)
+                                               .Bind (i, ac));
+            child->TraceConnectWithoutContext ("DropAfterDequeue",
+                                               MakeCallback (&WifiOfdmaExample::NotifyDropAfterDequeue, this)
+                                               .Bind (i, ac));
+          });
         }
     }
 
@@ -3443,62 +3737,51 @@ std::cout<<"Done\n";
         }
     }
 
-  Simulator::Schedule (Seconds (m_simulationTime / m_nIntervals),
-                       &WifiOfdmaExample::StoreCumulativeRxBytes, this);
   Simulator::Schedule (Seconds (m_simulationTime), &WifiOfdmaExample::StopStatistics, this);
 }
 
 void
-WifiOfdmaExample::StoreCumulativeRxBytes (void)
+WifiOfdmaExample::FlushThroughputSeries (void)
 {
-#if 0
-  Ptr<WifiMacQueue> queue = DynamicCast<RegularWifiMac> (DynamicCast<WifiNetDevice> (m_apDevices.Get (0))->GetMac ())->GetQosTxop (AC_BE)->GetWifiMacQueue ();
-  for (auto it = queue->QueuedPacketsBegin (); it != queue->QueuedPacketsEnd (); it++)
-    {
-      std::cout << "STA " << it->first.first << " : " << it->second << " MSDUs" << std::endl;
-    }
-#endif
-  std::map<AcIndex, double> dlTput, ulTput;
-  std::map<AcIndex, double>::iterator mapIt;
-
   for (std::size_t i = 0; i < m_flows.size (); i++)
     {
-      Ptr<PacketSink> sink = DynamicCast<PacketSink> (m_sinkApps.Get (i));
-      NS_ABORT_MSG_IF (sink == nullptr, "Not a PacketSink?");
+      auto &series = m_flows[i].m_tputSeries;
+      series.AdvanceTo (Simulator::Now ());
+      bool dl = (m_flows[i].m_direction == Flow::DOWNLINK);
+      double binWidthUs = series.GetBinWidth ().GetMicroSeconds ();
 
-      if (m_flows[i].m_direction == Flow::DOWNLINK)
-        {
-          mapIt = dlTput.insert ({m_flows[i].m_ac, 0.0}).first;
-        }
-      else
+      for (uint64_t bin = series.GetFirstBin (); bin < series.GetEndBin (); bin++)
         {
-          mapIt = ulTput.insert ({m_flows[i].m_ac, 0.0}).first;
+          m_tputLog.Write (series.GetBinStart (bin).GetMilliSeconds (), i,
+                           m_flows[i].m_stationId, std::string (dl ? "DL" : "UL"),
+                           m_aciToString.at (m_flows[i].m_ac),
+                           series.GetBytes (bin) * 8. / binWidthUs);
         }
-      mapIt->second += (sink->GetTotalRx () - m_flows[i].m_prevRxBytes) * 8. /
-                       (m_simulationTime / m_nIntervals * 1e6);
-      m_flows[i].m_prevRxBytes = sink->GetTotalRx ();
     }
-    
-    if(graph_stats == false){   
-  std::cout << "Per-AC throughput in the last time interval (time: " << Simulator::Now ().GetMicroSeconds () << ")"
-            << std::endl << "DOWNLINK" << std::endl;
-  for (auto& acMap : dlTput)
+
+  // per-AC throughput of every closed bin, summed over the flows of the same direction
+  std::map<std::pair<bool, AcIndex>, std::vector<double>> acTput;
+  for (auto &flow : m_flows)
     {
-      std::cout << "[" << m_aciToString.at (acMap.first) << "] " << acMap.second << std::endl;
+      auto &series = flow.m_tputSeries;
+      auto &tput = acTput[{flow.m_direction == Flow::DOWNLINK, flow.m_ac}];
+      tput.resize (std::max<std::size_t> (tput.size (), series.GetEndBin () - series.GetFirstBin ()));
+      for (uint64_t bin = series.GetFirstBin (); bin < series.GetEndBin (); bin++)
+        {
+          tput[bin - series.GetFirstBin ()] +=
+              series.GetBytes (bin) * 8. / series.GetBinWidth ().GetMicroSeconds ();
+        }
     }
-  std::cout << "UPLINK" << std::endl;
-  for (auto& acMap : ulTput)
+  for (auto &ac : acTput)
     {
-      std::cout << "[" << m_aciToString.at (acMap.first) << "] " << acMap.second << std::endl;
-    }
-  std::cout << std::endl;
+      auto &stats = (ac.first.first ? m_dlTputSeries : m_ulTputSeries)[ac.first.second];
+      for (auto &tput : ac.second)
+        {
+          stats.AddSample (tput);
+        }
     }
 
-  if (++m_elapsedIntervals < m_nIntervals)
-    {
-      Simulator::Schedule (Seconds (m_simulationTime / m_nIntervals),
-                           &WifiOfdmaExample::StoreCumulativeRxBytes, this);
-    }
+  m_tputLog.Flush ();
 }
 
 void
@@ -3507,11 +3790,18 @@ WifiOfdmaExample::StopStatistics (void)
   NS_LOG_FUNCTION (this);
 
   std::cout << "Stopping statistics at " << Simulator::Now ().GetMicroSeconds () << std::endl;
+  m_muSchedulerMetrics.clear ();
+  for (std::size_t ap = 0; ap < m_apDevices.GetN (); ap++)
+    {
+      if (auto scheduler = GetRrMuScheduler (m_apDevices.Get (ap)))
+        {
+          m_muSchedulerMetrics.emplace_back (ap, scheduler->GetMetrics ());
+        }
+    }
 
   if (m_verbose)
     {
-      Config::Disconnect ("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Phy/State/State",
-                          MakeCallback (&WifiOfdmaExample::NotifyStateChange, this));
+      ConnectPhyStateTraces (false);
     }
 
   /* Disconnect traces on all the stations (including the AP) and for all the ACs */
@@ -3521,6 +3811,7 @@ WifiOfdmaExample::StopStatistics (void)
   for (auto devIt = devices.Begin (); devIt != devices.End (); devIt++)
     {
       Ptr<WifiNetDevice> dev = DynamicCast<WifiNetDevice> (*devIt);
+      uint32_t nodeId = dev->GetNode ()->GetId ();
       Ptr<QosTxop> qosTxop;
 
       for (auto &ac : m_aciToString)
@@ -3531,19 +3822,19 @@ WifiOfdmaExample::StopStatistics (void)
           qosTxop = ptr.Get<QosTxop> ();
           // stop tracing expired MSDUs
           qosTxop->GetWifiMacQueue ()->TraceDisconnectWithoutContext ("Expired",
-            MakeCallback (&WifiOfdmaExample::NotifyMsduExpired, this));
+            MakeCallback (&WifiOfdmaExample::NotifyMsduExpired, this).Bind (nodeId));
           // qosTxop->GetBaManager ()->GetRetransmitQueue ()->TraceDisconnectWithoutContext ("Expired",
           //   MakeCallback (&WifiOfdmaExample::NotifyMsduExpired, this));
           // stop tracing rejected MSDUs
           qosTxop->GetWifiMacQueue ()->TraceDisconnectWithoutContext ("DropBeforeEnqueue",
-            MakeCallback (&WifiOfdmaExample::NotifyMsduRejected, this));
+            MakeCallback (&WifiOfdmaExample::NotifyMsduRejected, this).Bind (nodeId));
           // stop tracing packets enqueued in the EDCA queue
           qosTxop->GetWifiMacQueue ()->TraceDisconnectWithoutContext ("Enqueue",
             MakeCallback (&WifiOfdmaExample::NotifyEdcaEnqueue, this));
           // stop tracing MSDUs dequeued from the EDCA queue
           qosTxop->GetWifiMacQueue ()->TraceDisconnectWithoutContext ("Dequeue", 
             MakeCallback (&WifiOfdmaExample::NotifyMsduDequeuedFromEdcaQueue, this)
-            .Bind (qosTxop->GetWifiMacQueue ()->GetMaxDelay ()));
+            .Bind (qosTxop->GetWifiMacQueue ()->GetMaxDelay (), nodeId));
           // stop tracing TXOP duration
           // qosTxop->TraceDisconnectWithoutContext ("TxopTrace",
           //   MakeCallback (&WifiOfdmaExample::NotifyTxopDuration, this)
@@ -3601,14 +3892,12 @@ WifiOfdmaExample::StopStatistics (void)
       Ptr<QueueDisc> qdisc = tc->GetRootQueueDiscOnDevice (device);
       if (qdisc != nullptr && qdisc->GetNQueueDiscClasses () == 4)
         {
-          Ptr<QueueDisc> child;
-          for (auto &acStats : m_perAcStats.at (i))
-            {
-              child = qdisc->GetQueueDiscClass (static_cast<std::size_t> (acStats.first))
-                          ->GetQueueDisc ();
-              acStats.second.droppedByQueueDisc =
-                  child->GetStats ().nTotalDroppedPackets - acStats.second.droppedByQueueDisc;
-            }
+          m_perAcStats.at (i).ForEach ([&qdisc] (AcIndex ac, PerAcStats &stats) {
+            Ptr<QueueDisc> child =
+                qdisc->GetQueueDiscClass (static_cast<std::size_t> (ac))->GetQueueDisc ();
+            stats.droppedByQueueDisc =
+                child->GetStats ().nTotalDroppedPackets - stats.droppedByQueueDisc;
+          });
         }
     }
 
@@ -3634,6 +3923,8 @@ WifiOfdmaExample::StopStatistics (void)
         }
     }
 
+  FlushThroughputSeries ();
+
   // (Brutally) stop client applications
   for (auto &clientApp : m_clientApps)
     {
@@ -3651,10 +3942,17 @@ WifiOfdmaExample::StopStatistics (void)
   Simulator::Stop ();
 }
 
+Ptr<RrMultiUserScheduler>
+WifiOfdmaExample::GetRrMuScheduler (Ptr<NetDevice> apDevice) const
+{
+  auto mac = DynamicCast<WifiNetDevice> (apDevice)->GetMac ();
+  return DynamicCast<RrMultiUserScheduler> (mac->GetObject<MultiUserScheduler> ());
+}
+
 uint32_t
 WifiOfdmaExample::MacAddressToNodeId (Mac48Address address)
 {
-  if (m_apDevices.Get (0)->GetAddress () == address)
+  if (address == m_apAddress)
     {
       return m_apNodes.Get (0)->GetId ();
     }
@@ -3668,11 +3966,21 @@ WifiOfdmaExample::MacAddressToNodeId (Mac48Address address)
   NS_ABORT_MSG ("Found no node having MAC address " << address);
 }
 
-std::pair<std::map<AcIndex, WifiOfdmaExample::PairwisePerAcStats>::iterator, bool>
-WifiOfdmaExample::GetPairwisePerAcStats (const WifiMacHeader &hdr, AcIndex ac)
+WifiOfdmaExample::PairwisePerAcStats*
+WifiOfdmaExample::GetPairwisePerAcStats (Mac48Address src, Mac48Address dst, AcIndex ac)
 {
-  std::map<AcIndex, PairwisePerAcStats>::iterator mapIt;
+  if (src == m_apAddress)
+    {
+      // downlink
+      return m_dlPerStaAcStats[MacAddressToNodeId (dst) - 1].Find (ac);
+    }
+  // uplink
+  return m_ulPerStaAcStats[MacAddressToNodeId (src) - 1].Find (ac);
+}
 
+WifiOfdmaExample::PairwisePerAcStats*
+WifiOfdmaExample::GetPairwisePerAcStats (const WifiMacHeader &hdr, AcIndex ac)
+{
   if (hdr.IsQosData () && !hdr.GetAddr1 ().IsGroup ())
     {
       ac = QosUtilsMapTidToAc (hdr.GetQosTid ());
@@ -3680,27 +3988,30 @@ WifiOfdmaExample::GetPairwisePerAcStats (const WifiMacHeader &hdr, AcIndex ac)
   else if (!hdr.IsBlockAckReq () || ac == AC_UNDEF)
     {
       // we need to count BARs transmnitted in HE TB PPDUs
-      return std::make_pair (mapIt, false);
+      return nullptr;
     }
 
-  uint32_t srcNodeId = MacAddressToNodeId (hdr.GetAddr2 ());
-  uint32_t dstNodeId = MacAddressToNodeId (hdr.GetAddr1 ());
-  std::vector<std::map<AcIndex, PairwisePerAcStats>>::iterator vecIt;
+  return GetPairwisePerAcStats (hdr.GetAddr2 (), hdr.GetAddr1 (), ac);
+}
 
-  if (srcNodeId == 0)
-    {
-      // downlink
-      vecIt = std::next (m_dlPerStaAcStats.begin (), dstNodeId - 1);
-    }
-  else
+WifiOfdmaExample::PairwisePerAcStats*
+WifiOfdmaExample::GetPairwisePerAcStats (uint32_t srcNodeId, const WifiMacHeader &hdr)
+{
+  if (!hdr.IsQosData () || hdr.GetAddr1 ().IsGroup ())
     {
-      // uplink
-      vecIt = std::next (m_ulPerStaAcStats.begin (), srcNodeId - 1);
+      return nullptr;
     }
 
-  mapIt = vecIt->find (ac);
+  AcIndex ac = QosUtilsMapTidToAc (hdr.GetQosTid ());
 
-  return std::make_pair (mapIt, mapIt != vecIt->end ());
+  if (srcNodeId == m_apNodes.Get (0)->GetId ())
+    {
+      // downlink: the AP queues hold frames for all the stations, hence the receiver
+      // is still looked up by MAC address
+      return m_dlPerStaAcStats[MacAddressToNodeId (hdr.GetAddr1 ()) - 1].Find (ac);
+    }
+  // uplink
+  return m_ulPerStaAcStats[srcNodeId - 1].Find (ac);
 }
 
 void
@@ -3711,48 +4022,39 @@ WifiOfdmaExample::NotifyTxFailed (Ptr<const WifiMpdu> mpdu)
       return;
     }
 
-  auto itPair = GetPairwisePerAcStats (mpdu->GetHeader ());
+  auto pairStats = GetPairwisePerAcStats (mpdu->GetHeader ());
 
-  if (itPair.second)
+  if (pairStats)
     {
-      itPair.first->second.failed++;
+      pairStats->failed++;
     }
 }
 
 void
-WifiOfdmaExample::NotifyMsduExpired (Ptr<const WifiMpdu> item)
+WifiOfdmaExample::NotifyMsduExpired (uint32_t srcNodeId, Ptr<const WifiMpdu> item)
 {
-  if (item->GetHeader ().GetAddr1 ().IsGroup ())
-    {
-      return;
-    }
-
-  auto itPair = GetPairwisePerAcStats (item->GetHeader ());
+  auto pairStats = GetPairwisePerAcStats (srcNodeId, item->GetHeader ());
 
-  if (itPair.second)
+  if (pairStats)
     {
-      itPair.first->second.expired++;
+      pairStats->expired++;
     }
 }
 
 void
-WifiOfdmaExample::NotifyMsduRejected (Ptr<const WifiMpdu> item)
+WifiOfdmaExample::NotifyMsduRejected (uint32_t srcNodeId, Ptr<const WifiMpdu> item)
 {
-  if (item->GetHeader ().GetAddr1 ().IsGroup ())
-    {
-      return;
-    }
-
-  auto itPair = GetPairwisePerAcStats (item->GetHeader ());
+  auto pairStats = GetPairwisePerAcStats (srcNodeId, item->GetHeader ());
 
-  if (itPair.second)
+  if (pairStats)
     {
-      itPair.first->second.rejected++;
+      pairStats->rejected++;
     }
 }
 
 void
-WifiOfdmaExample::NotifyMsduDequeuedFromEdcaQueue (Time maxDelay, Ptr<const WifiMpdu> item)
+WifiOfdmaExample::NotifyMsduDequeuedFromEdcaQueue (Time maxDelay, uint32_t srcNodeId,
+                                                   Ptr<const WifiMpdu> item)
 {
   if (!item->GetHeader ().IsQosData () || item->GetHeader ().GetAddr1 ().IsGroup () ||
       Simulator::Now () > item->GetTimestamp() + maxDelay)
@@ -3762,35 +4064,33 @@ WifiOfdmaExample::NotifyMsduDequeuedFromEdcaQueue (Time maxDelay, Ptr<const Wifi
       return;
     }
 
-  uint32_t srcNodeId = MacAddressToNodeId (item->GetHeader ().GetAddr2 ());
-
   // update the pairwise HoL delay if this packet is being sent by the AP
   if (srcNodeId == 0)
     {
-      auto itPair = GetPairwisePerAcStats (item->GetHeader ());
+      auto pairStats = GetPairwisePerAcStats (srcNodeId, item->GetHeader ());
 
-      if (itPair.second)
+      if (pairStats)
         {
           // a new HoL sample is stored if this is not the first MSDU being dequeued
           // and if this MSDU is not dequeued to be aggregated to a previously dequeued
           // MSDU (which would give a null sample)
-          if (itPair.first->second.lastTxTime.IsStrictlyPositive () &&
-              Simulator::Now () > itPair.first->second.lastTxTime)
+          if (pairStats->lastTxTime.IsStrictlyPositive () &&
+              Simulator::Now () > pairStats->lastTxTime)
             {
               double newHolSample =
-                  (Simulator::Now () - Max (itPair.first->second.lastTxTime, item->GetTimestamp ()))
+                  (Simulator::Now () - Max (pairStats->lastTxTime, item->GetTimestamp ()))
                       .ToDouble (Time::MS);
-              itPair.first->second.pairwiseHol.AddSample (newHolSample);
+              pairStats->pairwiseHol.AddSample (newHolSample);
             }
-          itPair.first->second.lastTxTime = Simulator::Now ();
+          pairStats->lastTxTime = Simulator::Now ();
         }
     }
 
   // update the aggregate HoL delay
-  auto mapIt =
-      m_perAcStats.at (srcNodeId).find (QosUtilsMapTidToAc (item->GetHeader ().GetQosTid ()));
+  auto acStats =
+      m_perAcStats.at (srcNodeId).Find (QosUtilsMapTidToAc (item->GetHeader ().GetQosTid ()));
 
-  if (mapIt == m_perAcStats.at (srcNodeId).end ())
+  if (acStats == nullptr)
     {
       return;
     }
@@ -3798,16 +4098,16 @@ WifiOfdmaExample::NotifyMsduDequeuedFromEdcaQueue (Time maxDelay, Ptr<const Wifi
   // a new HoL sample is stored if this is not the first MSDU being dequeued
   // and if this MSDU is not dequeued to be aggregated to a previously dequeued
   // MSDU (which would give a null sample)
-  if (mapIt->second.lastTxTime.IsStrictlyPositive () &&
-      Simulator::Now () > mapIt->second.lastTxTime)
+  if (acStats->lastTxTime.IsStrictlyPositive () &&
+      Simulator::Now () > acStats->lastTxTime)
     {
       double newHolSample =
-          (Simulator::Now () - Max (mapIt->second.lastTxTime, item->GetTimestamp ()))
+          (Simulator::Now () - Max (acStats->lastTxTime, item->GetTimestamp ()))
               .ToDouble (Time::MS);
 
-      mapIt->second.aggregateHoL.AddSample (newHolSample);
+      acStats->aggregateHoL.AddSample (newHolSample);
     }
-  mapIt->second.lastTxTime = Simulator::Now ();
+  acStats->lastTxTime = Simulator::Now ();
 }
 
 void 
@@ -3865,10 +4165,10 @@ WifiOfdmaExample::NotifyPpduForwardedDown (Ptr<WifiPpdu> ppdu, WifiTxVector txVe
   //                 ac = QosUtilsMapTidToAc (baReqHdr.GetTidInfo ());
   //               }
 
-  //             auto itPair = GetPairwisePerAcStats (hdr, ac);
-  //             if (itPair.second)
+  //             auto pairStats = GetPairwisePerAcStats (hdr, ac);
+  //             if (pairStats)
   //               {
-  //                 // itPair.first->second.ampduRatio.AddSample (currRatio);
+  //                 // pairStats->ampduRatio.AddSample (currRatio);
   //               }
   //           }
   //         else if (hdr.GetType () == WIFI_MAC_QOSDATA_NULL)
@@ -4040,10 +4340,10 @@ WifiOfdmaExample::NotifyPpduForwardedDown (Ptr<WifiPpdu> ppdu, WifiTxVector txVe
                   ac = QosUtilsMapTidToAc (baReqHdr.GetTidInfo ());
                 }
 
-              auto itPair = GetPairwisePerAcStats (hdr, ac);
-              if (itPair.second)
+              auto pairStats = GetPairwisePerAcStats (hdr, ac);
+              if (pairStats)
                 {
-                  // itPair.first->second.ampduRatio.AddSample (currRatio);
+                  // pairStats->ampduRatio.AddSample (currRatio);
                 }
                 m_ulMuCompleteness.AddSample(ul_psduDurationSum.GetSeconds () /
                                         ppduduration.GetSeconds ());
@@ -4058,10 +4358,10 @@ WifiOfdmaExample::NotifyPpduForwardedDown (Ptr<WifiPpdu> ppdu, WifiTxVector txVe
 
       if (hdr.HasData ())
         {
-          auto itPair = GetPairwisePerAcStats (hdr);
-          if (itPair.second)
+          auto pairStats = GetPairwisePerAcStats (hdr);
+          if (pairStats)
             {
-              itPair.first->second.ampduSize.AddSample (psduMap.begin ()->second->GetSize ());
+              pairStats->ampduSize.AddSample (psduMap.begin ()->second->GetSize ());
             }
         }
 
@@ -4080,10 +4380,10 @@ WifiOfdmaExample::NotifyPpduForwardedDown (Ptr<WifiPpdu> ppdu, WifiTxVector txVe
   
       for (auto &psdu : psduMap)
         {
-          auto itPair = GetPairwisePerAcStats (psdu.second->GetHeader (0));
-          if (itPair.second)
+          auto pairStats = GetPairwisePerAcStats (psdu.second->GetHeader (0));
+          if (pairStats)
             {
-              itPair.first->second.ampduSize.AddSample (psdu.second->GetSize ());
+              pairStats->ampduSize.AddSample (psdu.second->GetSize ());
             }
         }
 
@@ -4122,10 +4422,10 @@ WifiOfdmaExample::NotifyPpduForwardedDown (Ptr<WifiPpdu> ppdu, WifiTxVector txVe
                   // currRatio = txDuration.GetSeconds () / dlMuPpduDuration.GetSeconds ();
                 }
 
-              auto itPair = GetPairwisePerAcStats (staIdPsdu.second->GetHeader (0));
-              if (itPair.second)
+              auto pairStats = GetPairwisePerAcStats (staIdPsdu.second->GetHeader (0));
+              if (pairStats)
                 {
-                  // itPair.first->second.ampduRatio.AddSample (currRatio);
+                  // pairStats->ampduRatio.AddSample (currRatio);
                 }
                 // std::cout << "currRatio: "<< currRatio<<"\n";
             }
@@ -4309,10 +4609,10 @@ WifiOfdmaExample::NotifyPsduForwardedDown (WifiConstPsduMap psduMap, WifiTxVecto
 //                   ac = QosUtilsMapTidToAc (baReqHdr.GetTidInfo ());
 //                 }
 
-//               auto itPair = GetPairwisePerAcStats (hdr, ac);
-//               if (itPair.second)
+//               auto pairStats = GetPairwisePerAcStats (hdr, ac);
+//               if (pairStats)
 //                 {
-//                   // itPair.first->second.ampduRatio.AddSample (currRatio);
+//                   // pairStats->ampduRatio.AddSample (currRatio);
 //                 }
 //             }
 //           else if (hdr.GetType () == WIFI_MAC_QOSDATA_NULL)
@@ -4323,10 +4623,10 @@ WifiOfdmaExample::NotifyPsduForwardedDown (WifiConstPsduMap psduMap, WifiTxVecto
 
 //       if (hdr.HasData ())
 //         {
-//           auto itPair = GetPairwisePerAcStats (hdr);
-//           if (itPair.second)
+//           auto pairStats = GetPairwisePerAcStats (hdr);
+//           if (pairStats)
 //             {
-//               itPair.first->second.ampduSize.AddSample (psduMap.begin ()->second->GetSize ());
+//               pairStats->ampduSize.AddSample (psduMap.begin ()->second->GetSize ());
 //             }
 //         }
         
@@ -4338,10 +4638,10 @@ WifiOfdmaExample::NotifyPsduForwardedDown (WifiConstPsduMap psduMap, WifiTxVecto
   
 //       for (auto &psdu : psduMap)
 //         {
-//           auto itPair = GetPairwisePerAcStats (psdu.second->GetHeader (0));
-//           if (itPair.second)
+//           auto pairStats = GetPairwisePerAcStats (psdu.second->GetHeader (0));
+//           if (pairStats)
 //             {
-//               itPair.first->second.ampduSize.AddSample (psdu.second->GetSize ());
+//               pairStats->ampduSize.AddSample (psdu.second->GetSize ());
 //             }
 //         }
 
@@ -4368,10 +4668,10 @@ WifiOfdmaExample::NotifyPsduForwardedDown (WifiConstPsduMap psduMap, WifiTxVecto
 //                   currRatio = txDuration.GetSeconds () / dlMuPpduDuration.GetSeconds ();
 //                 }
 
-//               auto itPair = GetPairwisePerAcStats (staIdPsdu.second->GetHeader (0));
-//               if (itPair.second)
+//               auto pairStats = GetPairwisePerAcStats (staIdPsdu.second->GetHeader (0));
+//               if (pairStats)
 //                 {
-//                   itPair.first->second.ampduRatio.AddSample (currRatio);
+//                   pairStats->ampduRatio.AddSample (currRatio);
 //                 }
 //                 std::cout << "currRatio: "<< currRatio<<"\n";
 //             }
@@ -4474,22 +4774,18 @@ WifiOfdmaExample::NotifyPsduForwardedDown (WifiConstPsduMap psduMap, WifiTxVecto
 void
 WifiOfdmaExample::NotifyTxopDuration (uint32_t nodeId, AcIndex ac, Time startTime, Time duration)
 {
-  auto mapIt = m_perAcStats.at (nodeId).find (ac);
-
-  if (mapIt != m_perAcStats.at (nodeId).end ())
+  if (auto acStats = m_perAcStats.at (nodeId).Find (ac))
     {
-      mapIt->second.txopDuration.AddSample (duration.ToDouble (Time::MS));
+      acStats->txopDuration.AddSample (duration.ToDouble (Time::MS));
     }
 }
 
 void
 WifiOfdmaExample::NotifySojournTime (std::size_t nodeId, AcIndex ac, Time sojournTime)
 {
-  auto mapIt = m_perAcStats.at (nodeId).find (ac);
-
-  if (mapIt != m_perAcStats.at (nodeId).end ())
+  if (auto acStats = m_perAcStats.at (nodeId).Find (ac))
     {
-      mapIt->second.queueDiscSojournTime.AddSample (sojournTime.ToDouble (Time::MS));
+      acStats->queueDiscSojournTime.AddSample (sojournTime.ToDouble (Time::MS));
     }
 }
 
@@ -4497,22 +4793,16 @@ void
 WifiOfdmaExample::NotifyDropAfterDequeue (std::size_t nodeId, AcIndex ac,
                                           Ptr<const QueueDiscItem> item, const char *reason)
 {
-  auto mapIt = m_perAcStats.at (nodeId).find (ac);
-
-  if (mapIt != m_perAcStats.at (nodeId).end ())
+  if (auto acStats = m_perAcStats.at (nodeId).Find (ac))
     {
       double sample = (Simulator::Now () - item->GetTimeStamp ()).ToDouble (Time::MS);
-      mapIt->second.queueDiscSojournTime.RemoveSample (sample);
+      acStats->queueDiscSojournTime.RemoveSample (sample);
     }
 }
 
 void
 WifiOfdmaExample::NotifyAppTx (std::size_t i, Ptr<const Packet> packet)
 {
-  if(!startThroughputcalc){startThroughputcalc=true;
-  currTime = Simulator::Now().GetMilliSeconds();
-  }
-
   prev_tx = Simulator::Now().GetMicroSeconds();
   m_flows[i].m_txBytes += packet->GetSize ();
   // m_flows[i].m_txPackets++;
@@ -4520,22 +4810,23 @@ WifiOfdmaExample::NotifyAppTx (std::size_t i, Ptr<const Packet> packet)
   
 
   bool inserted;
+  uint64_t seq = m_flows[i].packetsinFlow.Add ();
 
   if (m_flows[i].m_l4Proto == Flow::UDP)
     {
       inserted =
-          m_flows[i].m_inFlightPackets.insert ({packet->GetUid (), Simulator::Now ()}).second;
+          m_flows[i].m_inFlightPackets.insert ({packet->GetUid (), {Simulator::Now (), seq}}).second;
       NS_ABORT_MSG_IF (!inserted, "Duplicate UID " << packet->GetUid () << " with UDP?");
     }
   else
     {
-      inserted =
-          m_flows[i].m_inFlightPackets.insert ({m_flows[i].m_txBytes, Simulator::Now ()}).second;
-      NS_ABORT_MSG_IF (!inserted,
-                       "Duplicate total bytes sent " << m_flows[i].m_txBytes << " with TCP?");
+      auto txBytes = static_cast<uint64_t> (m_flows[i].m_txBytes);
+      auto &segments = m_flows[i].m_inFlightSegments;
+      NS_ABORT_MSG_IF (!segments.empty () && segments.back ().first >= txBytes,
+                       "Duplicate total bytes sent " << txBytes << " with TCP?");
+      segments.emplace_back (txBytes, Simulator::Now ());
     }
   // if(inserted){
-    m_flows[i].packetsinFlow.m_samples.insert({packet->GetUid(),false});
     m_flows[i].m_txPackets++;
 
   // }
@@ -4548,18 +4839,7 @@ WifiOfdmaExample::NotifyAppRx (std::size_t i, Ptr<const Packet> packet, const Ad
   // std::cout <<"Delay of packet from App to App layer " << prev_rx - prev_tx << '\n';
   // m_flows[i].m_rxPackets++; // incrementing received pkts count if it is found in inflightpackets
   
-  if(m_flows[i].m_direction == Flow::UPLINK && (++recvPackets)%1000==0){
-    double thru = 0;
-    prevTime=currTime;
-    currTime= Simulator::Now().GetMicroSeconds();
-    double timepassed = currTime-prevTime;
-     
-      thru= (packet->GetSize ()*8.0*1000)/(1.0*timepassed);
-     
-    std::cout<<"Printing throughput"<<thru<<" "<<recvPackets<<" \n";
-    Throughputs.push_back(thru);
-
-  }
+  m_flows[i].m_tputSeries.Add (Simulator::Now (), packet->GetSize ());
 
   if (m_flows[i].m_l4Proto == Flow::UDP)
     {
@@ -4576,47 +4856,24 @@ WifiOfdmaExample::NotifyAppRx (std::size_t i, Ptr<const Packet> packet, const Ad
   
 
 
-      m_flows[i].m_latency.AddSample ((Simulator::Now () - it->second).ToDouble (Time::MS));
-      m_flows[i].appLatencies.AddSample({packet->GetUid(),(Simulator::Now () - it->second).ToDouble (Time::MS)});
+      m_flows[i].m_latency.AddSample ((Simulator::Now () - it->second.first).ToDouble (Time::MS));
+      m_flows[i].packetsinFlow.MarkDelivered (it->second.second);
       m_flows[i].m_inFlightPackets.erase (it);
-
-      //////////////////////////////////////////////////////
-      auto it1 = m_flows[i].packetsinFlow.m_samples.find({packet->GetUid (),false});
-       if (it1 != m_flows[i].packetsinFlow.m_samples.end ()){
-           m_flows[i].packetsinFlow.m_samples.erase({packet->GetUid (),false});
-              m_flows[i].packetsinFlow.m_samples.insert({packet->GetUid (),true});
-            
-       }
     }
   else
     {
 
+      // all the segments sent before the received bytes are delivered, in order
       uint64_t totalBytesReceived = DynamicCast<PacketSink> (m_sinkApps.Get (i))->GetTotalRx ();
-      for (auto it = m_flows[i].m_inFlightPackets.begin (); it != m_flows[i].m_inFlightPackets.end (); )
+      auto &segments = m_flows[i].m_inFlightSegments;
+      while (!segments.empty () && segments.front ().first <= totalBytesReceived)
         {
-          if (it->first <= totalBytesReceived)
-            {
-              m_flows[i].m_latency.AddSample ((Simulator::Now () - it->second).ToDouble (Time::MS));
-
-              m_flows[i].appLatencies.AddSample({packet->GetUid(),(Simulator::Now () - it->second).ToDouble (Time::MS)});
-              it = m_flows[i].m_inFlightPackets.erase (it);
-            //   auto it1 = m_flows[i].packetsinFlow.m_samples.find({packet->GetUid (),false});
-
-            //  if (it1 != m_flows[i].packetsinFlow.m_samples.end ()){
-            //     m_flows[i].packetsinFlow.m_samples.erase({packet->GetUid (),false});
-            //     m_flows[i].packetsinFlow.m_samples.insert({packet->GetUid (),true});
-
-            //  }
-             m_flows[i].m_rxPackets++; // incrementing received pkts count if it is found in inflightpackets
-             m_flows[i].m_rxBytes += packet->GetSize ();
-
-
-             
-            }
-          else
-            {
-              it++;
-            }
+          m_flows[i].m_latency.AddSample ((Simulator::Now () - segments.front ().second).ToDouble (Time::MS));
+          m_flows[i].packetsinFlow.MarkDelivered (m_flows[i].packetsinFlow.GetCount ()
+                                                  - segments.size ());
+          segments.pop_front ();
+          m_flows[i].m_rxPackets++; // incrementing received pkts count if it is found in inflightpackets
+          m_flows[i].m_rxBytes += packet->GetSize ();
         }
 
  
@@ -4630,7 +4887,7 @@ WifiOfdmaExample::NotifyEdcaEnqueue (Ptr<const WifiMpdu> mpdu)
   mac_tx++;
   // std::cout << "NotifyEdcaEnqueue :" << mac_tx <<'\n';
   
-  m_flows[0].packetsinFlow_mac.m_samples.insert({mpdu->GetPacket()->GetUid(),false});
+  uint64_t macSeq = m_flows[0].packetsinFlow_mac.Add ();
  
   if (!mpdu->GetHeader ().IsQosData ())
     {
@@ -4670,6 +4927,7 @@ WifiOfdmaExample::NotifyEdcaEnqueue (Ptr<const WifiMpdu> mpdu)
   info.m_ac = QosUtilsMapTidToAc (mpdu->GetHeader ().GetQosTid ());
   info.m_ptrToPacket = mpdu->GetPacket ();
   info.m_edcaEnqueueTime = Simulator::Now ();
+  info.m_macSeq = macSeq;
   //add suitable condition
   // tcptime.insert({info.m_edcaEnqueueTime,mpdu->GetPacket()->GetUid()});
   mapIt->second.insert (mapIt->second.end (), info);
@@ -4681,12 +4939,6 @@ WifiOfdmaExample::NotifyMacForwardUp (Ptr<const Packet> p)
   mac_rx++;
   // std::cout << "NotifyMacForwardUp" << mac_rx << '\n';
   
-    auto it1 = m_flows[0].packetsinFlow_mac.m_samples.find({p->GetUid (),false});
-     if (it1 != m_flows[0].packetsinFlow_mac.m_samples.end ()){
-         m_flows[0].packetsinFlow_mac.m_samples.erase({p->GetUid (),false});
-            m_flows[0].packetsinFlow_mac.m_samples.insert({p->GetUid (),true});
-     } 
-
   auto mapIt = m_inFlightPacketMap.find (p->GetUid ());
   if (mapIt == m_inFlightPacketMap.end ())
     {
@@ -4706,6 +4958,8 @@ WifiOfdmaExample::NotifyMacForwardUp (Ptr<const Packet> p)
       return;
     }
 
+  m_flows[0].packetsinFlow_mac.MarkDelivered (listIt->m_macSeq);
+
   if (listIt->m_dstAddress.IsGroup ())
     {
       return;
@@ -4718,41 +4972,41 @@ WifiOfdmaExample::NotifyMacForwardUp (Ptr<const Packet> p)
 
   m_flows[0].m_rxPackets_mac++;
   m_flows[0].m_rxBytes_mac += p->GetSize();
-  std::vector<std::map<AcIndex, PairwisePerAcStats>>::iterator vecIt;
-
-  if (MacAddressToNodeId (listIt->m_srcAddress) == 0)
-    {
-      // downlink
-      vecIt = std::next (m_dlPerStaAcStats.begin (), MacAddressToNodeId (listIt->m_dstAddress) - 1);
-    }
-  else
-    {
-      // uplink
-      vecIt = std::next (m_ulPerStaAcStats.begin (), MacAddressToNodeId (listIt->m_srcAddress) - 1);
-    }
-
-  // NS_ABORT_MSG_IF (vecIt->find (listIt->m_ac) == vecIt->end (),
-  //                  "AC " << listIt->m_ac << " not found");
+  auto pairStats = GetPairwisePerAcStats (listIt->m_srcAddress, listIt->m_dstAddress, listIt->m_ac);
 
   NS_ABORT_MSG_IF (listIt->m_edcaEnqueueTime.IsZero (), "Unknown EDCA enqueue time for the packet");
 
-  if(vecIt->find (listIt->m_ac) == vecIt->end ()){
-    mapIt->second.erase (listIt);
-    return;
-  }else{
-  vecIt->at (listIt->m_ac)
-      .l2Latency.AddSample ((Simulator::Now () - listIt->m_edcaEnqueueTime).ToDouble (Time::MS));
-  }
+  if (pairStats != nullptr)
+    {
+      pairStats->l2Latency.AddSample ((Simulator::Now () - listIt->m_edcaEnqueueTime).ToDouble (Time::MS));
+    }
   mapIt->second.erase (listIt);
 }
 
-uint32_t
-WifiOfdmaExample::ContextToNodeId (const std::string &context)
+void
+WifiOfdmaExample::ConnectPhyStateTraces (bool connect)
 {
-  std::string sub = context.substr (10);
-  uint32_t pos = sub.find ("/Device");
-  uint32_t nodeId = atoi (sub.substr (0, pos).c_str ());
-  return nodeId;
+  for (auto nodeIt = NodeList::Begin (); nodeIt != NodeList::End (); nodeIt++)
+    {
+      for (uint32_t i = 0; i < (*nodeIt)->GetNDevices (); i++)
+        {
+          Ptr<WifiNetDevice> dev = DynamicCast<WifiNetDevice> ((*nodeIt)->GetDevice (i));
+          if (dev == nullptr)
+            {
+              continue;
+            }
+          auto callback =
+              MakeCallback (&WifiOfdmaExample::NotifyStateChange, this).Bind ((*nodeIt)->GetId ());
+          if (connect)
+            {
+              dev->GetPhy ()->GetState ()->TraceConnectWithoutContext ("State", callback);
+            }
+          else
+            {
+              dev->GetPhy ()->GetState ()->TraceDisconnectWithoutContext ("State", callback);
+            }
+        }
+    }
 }
 
 int